@@ -17,12 +17,27 @@
  *    - run a dynamic check-up on the application :
  *    		./DynamicCheckUp ./MyTargetApplication Parameter_1 Parameter_2 Parameter_3
  *    - DynamicCheckUp log will be written to "memory_check_up.txt"
+ *    - applications built with -fno-omit-frame-pointer can be unwound with frame pointers, much faster than backtrace :
+ *    		DCU_UNWINDER=frame-pointer ./DynamicCheckUp ./MyTargetApplication
+ *    - on x86-64 the call frame information of every module can be cached and used instead :
+ *    		DCU_UNWINDER=dwarf ./DynamicCheckUp ./MyTargetApplication
+ *    - stacks keep 8 frames from the caller of new, malloc... up to 64 can be kept :
+ *    		DCU_STACK_DEPTH=32 ./DynamicCheckUp ./MyTargetApplication
+ *    - sampling mode, only about one request every DCU_SAMPLE_INTERVAL bytes is tracked and the report is scaled back :
+ *    		DCU_SAMPLE_INTERVAL=524288 ./DynamicCheckUp ./MyTargetApplication
+ *    - threads can be tracked with lighter policies (full, sampled, counters, untracked) matched on their names :
+ *    		DCU_THREAD_POLICY="io-*=untracked,worker-*=sampled" ./DynamicCheckUp ./MyTargetApplication
+ *    - two-pass capture, the first run keeps only callers and writes the problem sites to the profile,
+ *      the next runs capture full stacks only for those sites :
+ *    		DCU_SITE_PROFILE=sites.txt ./DynamicCheckUp ./MyTargetApplication
+ *    - requests made with DCU_NEW (DynamicCheckUp.h) are recorded with their file and line, without unwinding :
+ *    		MyClass* object = DCU_NEW MyClass();
  *
  *    Makefile Flags
  *    - DCU_THREAD_SAFE
  *    						Use thread synchronization for memory requests and releases.
  *    - DCU_C_MEMORY_CHECK
- *    						CheckUp C memory functions (malloc, calloc, realloc, free)
+ *    						CheckUp C memory functions (malloc, calloc, realloc, free, and the aligned memalign, posix_memalign, aligned_alloc, valloc, pvalloc)
  *    						WARNING : C memory check-up is not accurate, and problems may be incorrectly reported
  *    - DCU_ECHO
  *    						Echo information while running application (only useful for static linking debug)
@@ -30,6 +45,41 @@
  *    						Aborts application and reporst when a memory release (free, delete) occurs on not requested memory (new, malloc, calloc)
  *    - DDCU_ABORT_ON_MEMORY_OVERWRITE
  *    						Aborts application and reports when a memory overwrite occurs
+ *    - DCU_SHARD_COUNT=n
+ *    						Number of independent tracker shards (default 16). Each shard has its own lock,
+ *    						operation table, stats and problems, and they are merged when the report is written.
+ *    - DCU_LOCK_FREE_TABLE
+ *    						Keep live blocks on a lock-free open addressing table instead of the shard buckets,
+ *    						requests and releases only take a shard lock when a problem is found.
+ *    						DCU_LOCK_FREE_TABLE_BITS=n sets the table size to 2^n slots (default 22).
+ *    - DCU_THREAD_MSPACES
+ *    						Every thread requests memory from its own dlmalloc mspace, releases from other threads
+ *    						are routed back to the owner mspace.
+ *    - DCU_ASYNC_TRACKING
+ *    						Requests capture their stack and push an event on a per-thread ring, releases only push
+ *    						an event, a tracker thread keeps the allocation table and stats. Deallocation stacks are
+ *    						not captured. Reallocs are tracked by the calling thread.
+ *    						DCU_ASYNC_OVERFLOW_SPILL applies events on the calling thread when its ring is full,
+ *    						by default the thread waits for the tracker.
+ *    - DCU_INLINE_HEADERS
+ *    						Keep the size, type and stack id of every block in a 32 byte header in front of it,
+ *    						releases find it by pointer arithmetic and leaks are enumerated from intrusive lists
+ *    						instead of the hash table. Can't be combined with DCU_PASSTHROUGH.
+ *    - DCU_COMPACT_RECORDS
+ *    						Keep live blocks as 16 byte records (packed address, 40 bit size, type and interned
+ *    						stack id) inside the operation tables, for heaps with tens of millions of blocks.
+ *    						Requests over 1 TiB aren't tracked, they are counted as oversized on the report.
+ *    - DCU_CONTEXT_REPORT_PERCENT=n
+ *    						Calling context subtrees under n percent of the requested memory (default 1) are left
+ *    						out of the report, unless they still hold memory.
+ *    - DCU_PASSTHROUGH
+ *    						User blocks come from the next allocator (the C library's unless another one is preloaded),
+ *    						resolved with dlsym(RTLD_NEXT), so timings and RSS are the production ones.
+ *    						Blocks missing from the table are released and resized by the next allocator
+ *    						without a report. Can't be combined with DCU_THREAD_MSPACES or DCU_INLINE_HEADERS.
+ *    - DCU_MMAP_TRACKING
+ *    						CheckUp anonymous mappings (mmap, munmap, mremap), leaked mappings and partial unmaps are
+ *    						reported and mapped bytes are part of the memory balance.
  *
  *    Revisions:
  *    - xx.12.08 - Main code development.
@@ -46,20 +96,75 @@
  *               - The first call to backtrace calls malloc, so we must call it explicity on DCU_initialize()
  *               - Support for x64 systems.
  *               - added memalign (but it is not used by the memory management system)
+ *    - 16.10.26 - Tracker state sharded by address, DCU_mutex is only used for initialization.
+ *               - The memory space is created with locks, user blocks are allocated outside the shard locks.
+ *               - Lock-free allocation table (DCU_LOCK_FREE_TABLE), shard buckets are used on overflow.
+ *               - Per-thread mspaces (DCU_THREAD_MSPACES).
+ *               - Releases of unallocated memory are reported but no longer handed to the allocator.
+ *               - Tracker records live on their own metadata mspace, its footprint is reported apart.
+ *               - Operation and problem records come from slabs through per-thread magazines.
+ *               - Asynchronous tracking through per-thread event rings (DCU_ASYNC_TRACKING).
+ *               - Block header records (DCU_INLINE_HEADERS).
+ *               - Live operations are kept on growable open addressing tables with SSE2 group probing,
+ *                 replacing the fixed hash buckets.
+ *               - Compact records with interned stacks (DCU_COMPACT_RECORDS), tracker bytes per block reported.
+ *               - Stack traces are always interned, operations and problems keep 32 bit stack ids.
+ *               - Calling-context tree of allocation stacks with live and total rollups on the report.
+ *               - Problems are found through a hash index keyed by type and stack ids.
+ *               - Frame pointer unwinder selected with DCU_UNWINDER, backtrace is its fallback.
+ *               - DWARF unwinder with rules compiled from .eh_frame and cached per address (DCU_UNWINDER=dwarf).
+ *               - Stack depth set with DCU_STACK_DEPTH, stacks start at the caller and skip the tracker frames.
+ *               - Poisson sampling of requested bytes (DCU_SAMPLE_INTERVAL), unsampled blocks skip the tracker.
+ *               - Two-pass stack capture driven by a site profile of problem callers (DCU_SITE_PROFILE).
+ *               - DCU_NEW allocation sites with static descriptors, reported as file:line (DynamicCheckUp.h).
+ *               - Per-thread tracking policies (DCU_setThreadPolicy, DCU_THREAD_POLICY), tracked chunks are marked.
+ *               - Thread scoped suppression of tracking (DCU_suppressBegin, DCU_suppressEnd, DCU_SuppressGuard).
+ *               - Passthrough mode tracking on top of the next allocator (DCU_PASSTHROUGH).
+ *               - Nothrow, sized and aligned new/delete hooks, sized releases are checked against the request.
+ *               - Tracked memalign, posix_memalign, aligned_alloc, valloc and pvalloc, malloc_usable_size returns
+ *                 the requested size of tracked blocks.
+ *               - Anonymous mappings tracked on a sorted region list (DCU_MMAP_TRACKING).
+ *               - One-time initialization on an atomic state, started by a priority constructor, requests made
+ *                 meanwhile come from a static bootstrap arena. Operation tables are mapped on demand.
  *
  *
  */
 
 static unsigned char DCU_flags = 0;
 
-void DCU_initialize();
+/*
+ * DCU_InitializationState
+ * 		The tracker is initialized once, by DCU_bootstrap or by an earlier request (constructors of
+ * 		other libraries). The thread that moves DCU_init_state out of DCU_InitPending initializes,
+ * 		other threads wait for DCU_InitDone. Requests the initializing thread makes before the memory
+ * 		spaces exist (dlsym, pthread_atfork) are served from DCU_bootstrap_arena.
+ */
+enum DCU_InitializationState
+{
+	DCU_InitPending,
+	DCU_InitRunning,
+	DCU_InitSpacesReady,
+	DCU_InitDone
+};
+
+static int DCU_init_state = DCU_InitPending;
+
+bool DCU_initializeTracker();
 void DCU_shutdown();
 
-static struct DCU_Bootstrap
+//
+// every request checks it, a single load once the tracker is initialized
+// false while the calling thread is initializing and the memory spaces don't exist yet
+//
+inline bool DCU_initialize()
 {
-	DCU_Bootstrap() { DCU_initialize(); }
-	~DCU_Bootstrap() { DCU_shutdown(); }
-} DCU_BootstrapObject;
+	if (__builtin_expect(__atomic_load_n(&DCU_init_state, __ATOMIC_ACQUIRE) == DCU_InitDone, 1))
+	{
+		return true;
+	}
+
+	return DCU_initializeTracker();
+}
 
 
 #define USE_LOCKS 1
@@ -67,14 +172,106 @@ static struct DCU_Bootstrap
 #define ONLY_MSPACES 1
 #define NO_MALLINFO 1
 //#define FOOTERS 1
+#ifdef DCU_THREAD_MSPACES
+#define FOOTERS 1
+#endif //DCU_THREAD_MSPACES
 #define DEFAULT_GRANULARITY (1 * 1024 * 1024)
+
+//
+// dlmalloc and the tracker map their memory with the system calls,
+// so with DCU_MMAP_TRACKING only the application's mappings reach the hooks
+//
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+inline void* DCU_systemMmap(void* address, size_t length, int protection, int flags, int fd, off_t offset)
+{
+#ifdef SYS_mmap2
+	return (void*) syscall(SYS_mmap2, address, length, protection, flags, fd, offset / 4096);
+#else
+	return (void*) syscall(SYS_mmap, address, length, protection, flags, fd, offset);
+#endif //SYS_mmap2
+}
+
+inline int DCU_systemMunmap(void* address, size_t length)
+{
+	return (int) syscall(SYS_munmap, address, length);
+}
+
+inline void* DCU_systemMremap(void* address, size_t old_length, size_t new_length, int flags, void* new_address)
+{
+	return (void*) syscall(SYS_mremap, address, old_length, new_length, flags, new_address);
+}
+
+#ifdef DCU_INLINE_HEADERS
+//
+// block headers are only read inside the address range mapped for the mspaces
+//
+static unsigned long DCU_space_low = ~0UL;
+static unsigned long DCU_space_high;
+
+inline void* DCU_spaceMapped(void* address, size_t length)
+{
+	if (address != MAP_FAILED)
+	{
+		unsigned long low = __atomic_load_n(&DCU_space_low, __ATOMIC_RELAXED);
+		while ((unsigned long) address < low)
+		{
+			if (__atomic_compare_exchange_n(&DCU_space_low, &low, (unsigned long) address, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+
+		unsigned long high = __atomic_load_n(&DCU_space_high, __ATOMIC_RELAXED);
+		while ((unsigned long) address + length > high)
+		{
+			if (__atomic_compare_exchange_n(&DCU_space_high, &high, (unsigned long) address + length, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+	}
+
+	return address;
+}
+
+#define MMAP(s) DCU_spaceMapped(DCU_systemMmap(0, (s), MMAP_PROT, MMAP_FLAGS, -1, 0), (s))
+#define MREMAP(addr, osz, nsz, mv) DCU_spaceMapped(DCU_systemMremap((addr), (osz), (nsz), (mv), 0), (nsz))
+#else
+#define MMAP(s) DCU_systemMmap(0, (s), MMAP_PROT, MMAP_FLAGS, -1, 0)
+#define MREMAP(addr, osz, nsz, mv) DCU_systemMremap((addr), (osz), (nsz), (mv), 0)
+#endif //DCU_INLINE_HEADERS
+#define DIRECT_MMAP(s) MMAP(s)
+#define MUNMAP(a, s) DCU_systemMunmap((a), (s))
+
+//
+// with FOOTERS mspace_free finds the owner of a chunk on its footer and leaves its mspace argument unused
+//
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
 #include "malloc.c.h"
+#pragma GCC diagnostic pop
+#include "DynamicCheckUp.h"
 
 #include <cstdio>
 #include <cstring>
 #include <cstdarg>
+#include <cstdlib>
 #include <signal.h>
 #include <execinfo.h>
+#include <link.h>
+#include <dlfcn.h>
+#include <fnmatch.h>
+#include <dlfcn.h>
+#include <sys/prctl.h>
+#include <cmath>
+#include <cerrno>
+#include <malloc.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif //__SSE2__
 
 class DCU_MutexScopedLock
 {
@@ -97,6 +294,26 @@ private:
 	pthread_mutex_t& mutex_;
 };
 
+//
+// initial-exec thread local storage is reserved at load time, using it never calls malloc
+//
+#define DCU_THREAD_LOCAL __thread __attribute__((tls_model("initial-exec")))
+
+class DCU_NullScopedLock
+{
+public:
+	DCU_NullScopedLock(pthread_mutex_t&) {}
+};
+
+//
+// Lock held while the allocation table is touched
+//
+#ifdef DCU_LOCK_FREE_TABLE
+typedef DCU_NullScopedLock DCU_TableScopedLock;
+#else
+typedef DCU_MutexScopedLock DCU_TableScopedLock;
+#endif //DCU_LOCK_FREE_TABLE
+
 /*
  * OVERWRITE_DETECTION_DATA
  * OVERWRITE_DETECTION_DATA_SIZE
@@ -123,17 +340,22 @@ private:
 #define ALLOCATION_VALUE				0xAA
 #define DEALLOCATION_VALUE				0xEE
 
-#define DCU_DYNAMIC_OPERATION_TYPES		8
+#define DCU_DYNAMIC_OPERATION_TYPES		13
 enum DCU_DynamicOperationType
 {
 	DCU_MallocType,
 	DCU_FreeType,
 	DCU_ReallocType,
 	DCU_CallocType,
+	DCU_MemalignType,
 	DCU_NewType,
 	DCU_DeleteType,
 	DCU_NewArrayType,
-	DCU_DeleteArrayType
+	DCU_DeleteArrayType,
+	DCU_NewAlignedType,
+	DCU_DeleteAlignedType,
+	DCU_NewArrayAlignedType,
+	DCU_DeleteArrayAlignedType
 };
 
 static const char* DCU_OperationTypeNames[] =
@@ -142,13 +364,18 @@ static const char* DCU_OperationTypeNames[] =
 		"Free",
 		"Realloc",
 		"Calloc",
+		"Memalign",
 		"new",
 		"delete",
 		"new[]",
-		"delete[]"
+		"delete[]",
+		"new(align)",
+		"delete(align)",
+		"new[](align)",
+		"delete[](align)"
 };
 
-#define DCU_DYNAMIC_PROBLEM_TYPES		6
+#define DCU_DYNAMIC_PROBLEM_TYPES		9
 enum DCU_ProblemType
 {
 	DCU_LeakType,
@@ -156,7 +383,10 @@ enum DCU_ProblemType
 	DCU_MismatchOperationType,
 	DCU_FreeNullType,
 	DCU_RequestZeroMemoryType,
-	DCU_MemoryOverWriteType
+	DCU_MemoryOverWriteType,
+	DCU_ReleaseSizeMismatchType,
+	DCU_MappingLeakType,
+	DCU_PartialUnmapType
 };
 
 static const char* DCU_ProblemTypenames[] =
@@ -167,6 +397,9 @@ static const char* DCU_ProblemTypenames[] =
 		"Free Null Pointer",
 		"Request Zero Memory",
 		"Memory Over-Write",
+		"Mismatch Sized Deletion",
+		"Mapping Leak",
+		"Partial Unmap",
 };
 
 typedef void* DCU_Pointer;
@@ -174,875 +407,6570 @@ typedef void const* DCU_ConstPointer;
 typedef unsigned long DCU_MemoryInt;
 typedef long DCU_SignedMemoryInt;
 
+/*
+ * DCU_WEIGHT_ONE
+ * 		Sampled operations stand for 1 / probability operations, a fraction. Operation counts
+ * 		(stats, calling contexts and problems) are kept in fixed point with DCU_WEIGHT_BITS fraction
+ * 		bits and rounded by DCU_unweight when the report prints them. Byte totals stay in bytes,
+ * 		every operation adds its size times its weight rounded to the byte.
+ */
+#define DCU_WEIGHT_BITS 16
+#define DCU_WEIGHT_ONE (DCU_MemoryInt(1) << DCU_WEIGHT_BITS)
+#define DCU_unweight(count) ( (DCU_MemoryInt(count) + DCU_WEIGHT_ONE / 2) >> DCU_WEIGHT_BITS )
+#define DCU_weightedSize(size, weight) ( (DCU_MemoryInt(size) * (weight) + DCU_WEIGHT_ONE / 2) >> DCU_WEIGHT_BITS )
+
 struct DCU_MemoryStats
 {
-	DCU_MemoryInt count;
+	DCU_MemoryInt count; // fixed point, see DCU_WEIGHT_ONE
 	DCU_MemoryInt total_memory;
 	DCU_MemoryInt max_value;
 };
 
-#define DCU_STACK_TRACE_SIZE 8
+/*
+ * DCU_STACK_DEFAULT_DEPTH
+ * 		Frames kept per stack, the DCU_STACK_DEPTH environment variable sets it from 1 to
+ * 		DCU_STACK_MAX_DEPTH at startup. Frames of the tracker and its hooks are captured on top
+ * 		(at most DCU_STACK_SKIP_LIMIT of them) and dropped, stacks start at the hook's caller.
+ */
+#define DCU_STACK_DEFAULT_DEPTH 8
+#define DCU_STACK_MAX_DEPTH 64
+#define DCU_STACK_SKIP_LIMIT 8
+#define DCU_STACK_DEPTH_VARIABLE "DCU_STACK_DEPTH"
+
+//
+// stack traces are interned on the stack table, records only keep their id
+//
+typedef unsigned int DCU_StackId;
+#define DCU_NULL_STACK 0
 
 struct DCU_OperationInfo
 {
 	DCU_OperationInfo *next;
 	DCU_DynamicOperationType type;
+	bool sampled; // weighted by DCU_operationWeight
 	DCU_ConstPointer memory_address;
 	size_t size;
-	DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE];
+	DCU_StackId stack;
 };
 
 struct DCU_ProblemInfo
 {
 	DCU_ProblemInfo *next;
+	DCU_ProblemInfo *bucket_next; // next problem on the same index bucket
 	DCU_ProblemType type;
 	size_t size;
 	size_t count;
 	DCU_MemoryInt total_memory;
-	DCU_ConstPointer allocation_stack[DCU_STACK_TRACE_SIZE];
-	DCU_ConstPointer deallocation_stack[DCU_STACK_TRACE_SIZE];
+	DCU_StackId allocation_stack;
+	DCU_StackId deallocation_stack;
 };
 
-#define DCU_INITIALIZED			1
-#define DCU_TRACING				2
-#define DCU_FINISHED			4
-#define DCU_MUTEX_INITED		8
+#define DCU_CACHE_LINE_SIZE 64
 
-#define DCU_SET_FLAG(flag) (DCU_flags |= flag)
-#define DCU_CLEAR_FLAG(flag) (DCU_flags &= ~flag)
-#define DCU_STATE(flag) (DCU_flags & flag)
+/*
+ * DCU_HASH_FUNCTION
+ * 		Multiplicative (fibonacci) hash of a block address, the upper half is folded into the lower one
+ * 		so blocks at the same offset of different regions don't collide.
+ * 		Shards are picked with the upper half, the shard tables use the lower one.
+ */
+typedef size_t HastIterator;
+#define DCU_HASH_HALF_BITS (sizeof(HastIterator) * 4)
+#define DCU_HASH_FUNCTION(address) \
+	( DCU_foldHash(HastIterator(DCU_MemoryInt(address) >> 3) * HastIterator(0x9E3779B97F4A7C15ULL)) )
+#define DCU_SHARD_INDEX(hash) ( ((hash) >> DCU_HASH_HALF_BITS) % HastIterator(DCU_SHARD_COUNT) )
 
-#define DCU_OUTPUT_FILE "memory_check_up.txt"
-#define DCU_FALLBACK_STREAM stdout
+inline HastIterator DCU_foldHash(HastIterator hash)
+{
+	return hash ^ (hash >> DCU_HASH_HALF_BITS);
+}
 
-typedef size_t HastIterator;
-#define DCU_HASH_TABLE_SIZE 35323 //prime number, for many allocations use 343051
-#define DCU_HASH_FUNCTION(address) (  HastIterator(address) % HastIterator(DCU_HASH_TABLE_SIZE) )
+/*
+ * DCU_OperationTable
+ * 		Open addressing table of live operations, one per shard.
+ * 		Slots are probed a group of DCU_TABLE_GROUP_SIZE at a time, every slot has a control byte
+ * 		holding 7 bits of the hash (or empty / deleted), so a group is matched with two SSE2
+ * 		compares and only candidates with the same fingerprint are dereferenced.
+ * 		Full slots have the sign bit set and empty ones are zero, storages are mapped anonymously
+ * 		and the kernel zeroes their pages on first touch.
+ * 		When the table is 7/8 used a new one is allocated and the live operations are moved
+ * 		DCU_TABLE_MIGRATION_STEP slots per request or release, lookups check both tables meanwhile.
+ */
+#define DCU_TABLE_GROUP_SIZE 16
+#define DCU_TABLE_INITIAL_CAPACITY 1024 // per shard, power of two
+#define DCU_TABLE_MIGRATION_STEP 64
+#define DCU_TABLE_EMPTY ((signed char) 0)
+#define DCU_TABLE_DELETED ((signed char) 1)
+#define DCU_TABLE_NOT_FOUND (~HastIterator(0))
+#define DCU_TABLE_GROUP(hash) ( (hash) >> 7 )
+#define DCU_TABLE_FINGERPRINT(hash) ( (signed char) (((hash) & 0x7F) | 0x80) )
+#define DCU_TABLE_FULL(control) ( (control) < 0 )
 
-static mspace memory_space;
-#define DCU_malloc(size) mspace_malloc(memory_space, size)
-#define DCU_free(p) mspace_free(memory_space, p)
-#define DCU_realloc(p, size) mspace_realloc(memory_space, p, size)
-#define DCU_calloc(nmemb, size) mspace_calloc(memory_space, nmemb, size)
-#define DCU_memalign(msp, alignment, bytes) mspace_memalign(memory_space, alignment, bytes)
+/*
+ * DCU_CompactRecord
+ * 		With DCU_COMPACT_RECORDS the operation tables keep 16 byte records instead of pointers to
+ * 		DCU_OperationInfo. The address (8 byte aligned, so shifted by 3) takes 48 bits, the size 40 bits,
+ * 		the type 4 bits, the sampled flag 1 bit and the interned stack 32 bits. Larger requests aren't
+ * 		tracked, they are counted as oversized on the report.
+ * 		Operations are unpacked to a DCU_OperationInfo when they leave the table.
+ */
+#ifdef DCU_COMPACT_RECORDS
 
-#define DCU_STREAM_BUFFER_SIZE 512
-static FILE* DCU_stream;
-static char stream_trace_buffer[DCU_STREAM_BUFFER_SIZE];
+#ifdef DCU_LOCK_FREE_TABLE
+#error "DCU_COMPACT_RECORDS and DCU_LOCK_FREE_TABLE can't be used together"
+#endif //DCU_LOCK_FREE_TABLE
 
-static pthread_mutex_t DCU_mutex;
-static DCU_OperationInfo** DCU_memory;
-static DCU_ProblemInfo* DCU_problems;
+#ifdef DCU_INLINE_HEADERS
+#error "DCU_COMPACT_RECORDS and DCU_INLINE_HEADERS can't be used together"
+#endif //DCU_INLINE_HEADERS
 
-static DCU_MemoryStats DCU_memory_stats[DCU_DYNAMIC_OPERATION_TYPES];
-static DCU_MemoryStats DCU_memory_stats_c;
-static DCU_MemoryStats DCU_memory_stats_new;
-static DCU_MemoryStats DCU_memory_stats_new_array;
+typedef unsigned long long DCU_RecordWord;
 
-static DCU_ConstPointer DCU_null_stack[DCU_STACK_TRACE_SIZE];
+#define DCU_COMPACT_ADDRESS_MASK 0xFFFFFFFFFFFFULL
+#define DCU_COMPACT_MAX_SIZE 0xFFFFFFFFFFULL
+#define DCU_COMPACT_ADDRESS(address) ( DCU_RecordWord(DCU_MemoryInt(address) >> 3) )
 
-void* DCU_requestMemory(DCU_DynamicOperationType const& type, size_t size, void* pointer);
-void DCU_releaseMemory(DCU_DynamicOperationType const& type, void* pointer);
+struct DCU_CompactRecord
+{
+	DCU_RecordWord address_size; // address on the low 48 bits, size bits 0-15 on the high ones
+	DCU_RecordWord size_type_stack; // size bits 16-39, type on bits 24-27, sampled on bit 28, stack id on the high 32 bits
+};
 
-void DCU_analyzeMemory();
-void DCU_reportMemoryStatus();
+typedef DCU_CompactRecord DCU_TableSlot;
 
-DCU_OperationInfo* DCU_createOperation();
-DCU_ProblemInfo* DCU_createProblem();
+static DCU_MemoryInt DCU_oversized_requests;
 
-//
-// Generic DCU_OperationInfo Linked-List Management
-//
-void DCU_emptyOperationList(DCU_OperationInfo** list);
-void DCU_removeOperationFromList(DCU_OperationInfo** list, DCU_OperationInfo* element);
-DCU_OperationInfo* DCU_findOperationOnList(DCU_OperationInfo* list, DCU_ConstPointer memory_address);
-void DCU_addOperationToList(DCU_OperationInfo** list, DCU_OperationInfo* element);
+#else
 
-//
-// Generic DCU_ProblemInfo Linked-List Management
-//
-void DCU_emptyProblemList(DCU_ProblemInfo** list);
-void DCU_addProblemToList(DCU_ProblemInfo** list, DCU_ProblemInfo* element);
-DCU_ProblemInfo* DCU_findProblem(DCU_ProblemInfo** list, DCU_ProblemType const type,
-								DCU_ConstPointer allocation_stack[DCU_STACK_TRACE_SIZE],
-								DCU_ConstPointer deallocation_stack[DCU_STACK_TRACE_SIZE]);
+typedef DCU_OperationInfo* DCU_TableSlot;
 
-//
-// Hash table management
-//
-void DCU_addMemory(DCU_OperationInfo* element);
-DCU_OperationInfo* DCU_findMemory(DCU_ConstPointer memory_address);
-void DCU_removeMemory(DCU_OperationInfo* element);
-void DCU_emptyMemory();
+#endif //DCU_COMPACT_RECORDS
 
-void DCU_createStackTrace(DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE]);
-bool DCU_stacksMatch(DCU_ConstPointer lhs[DCU_STACK_TRACE_SIZE], DCU_ConstPointer rhs[DCU_STACK_TRACE_SIZE]);
+/*
+ * DCU_ProblemRegistry
+ * 		Problems found on a shard, or merged for the report. Problems are kept on a list in the order
+ * 		they are reported and on a chained hash index keyed by type and stack ids, the index doubles
+ * 		when it holds as many problems as buckets. Without an index (no memory) the list is walked.
+ */
+#define DCU_PROBLEM_INDEX_INITIAL_CAPACITY 64 // power of two
 
-void DCU_abort(char const* message, ...);
-void DCU_write(char const* message, ...);
+struct DCU_ProblemRegistry
+{
+	DCU_ProblemInfo* list;
+	DCU_ProblemInfo** index;
+	HastIterator capacity;
+	HastIterator count;
+};
 
-//
-// Implementation
-//
+struct DCU_TableStorage
+{
+	signed char* control;
+	DCU_TableSlot* slots;
+	HastIterator capacity;
+};
 
-void DCU_initialize()
+struct DCU_OperationTable
 {
-	if (DCU_STATE(DCU_INITIALIZED))
-	{
-		return;
-	}
+	DCU_TableStorage current;
+	DCU_TableStorage old; // old.control is null when no migration is running
+	HastIterator migrated; // old slots already moved
+	HastIterator used; // full and deleted slots of the current storage
+	HastIterator size; // live operations on both storages
+};
 
-	if (DCU_STATE(DCU_MUTEX_INITED))
-	{
-		DCU_MutexScopedLock lock(DCU_mutex);
-		if (DCU_STATE(DCU_INITIALIZED))
-		{
-			return;
-		}
-		else
-		{
-			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp Concurrency error.\n");
-			_exit(1);
-		}
-	}
+/*
+ * DCU_StackTable
+ * 		Interned stack traces, every distinct stack is stored once and named by a 32 bit id.
+ * 		Frames are stored back to back on per-stripe arenas, so stacks take only their own depth.
+ * 		Stacks are spread by hash over DCU_STACK_STRIPES stripes, each with its own lock and open
+ * 		addressing index. The low bits of an id are its stripe and stored stacks never move,
+ * 		so an id is resolved without any lock. Id 0 is the null stack, it is also used when
+ * 		a stripe runs out of chunks.
+ * 		Every thread remembers the last DCU_STACK_CACHE_SIZE stacks it interned, hot allocation
+ * 		sites are found there without taking a stripe lock.
+ */
+#define DCU_STACK_STRIPES 16 // power of two
+#define DCU_STACK_STRIPE_BITS 4
+#define DCU_STACK_CHUNK_BITS 12
+#define DCU_STACK_CHUNK_SIZE (1u << DCU_STACK_CHUNK_BITS)
+#define DCU_STACK_DIRECTORY_SIZE 1024
+#define DCU_STACK_INDEX_INITIAL_CAPACITY 1024 // power of two
+#define DCU_STACK_CACHE_SIZE 64 // power of two
+#define DCU_STACK_ARENA_FRAMES 8192
 
-	if (pthread_mutex_init(&DCU_mutex, 0) < 0)
-	{
-		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to initialize mutex\n");
-		_exit(1);
-	}
-	else
-	{
-		DCU_SET_FLAG(DCU_MUTEX_INITED);
-	}
+/*
+ * DCU_ContextNode
+ * 		Calling-context tree, a trie of stack frames whose root children are the outermost
+ * 		captured frames. Every interned stack is attributed to the node of its innermost frame,
+ * 		nodes are created when a new stack is interned and never removed.
+ * 		Requests and releases only update the counters of their own node, the subtree rollups
+ * 		are summed in a single post-order pass when the report is written.
+ */
+#ifndef DCU_CONTEXT_REPORT_PERCENT
+#define DCU_CONTEXT_REPORT_PERCENT 1
+#endif //DCU_CONTEXT_REPORT_PERCENT
 
+struct DCU_ContextRollup
+{
+	DCU_MemoryInt live_count;
+	DCU_MemoryInt live_memory;
+	DCU_MemoryInt total_count;
+	DCU_MemoryInt total_memory;
+};
 
-	{
-		DCU_MutexScopedLock lock(DCU_mutex);
+struct DCU_ContextNode
+{
+	DCU_ConstPointer frame;
+	DCU_ContextNode* children;
+	DCU_ContextNode* next_sibling;
+	DCU_ContextNode* last_child; // child found by the last lookup, stacks of a site share their prefix
+	DCU_MemoryInt requests;
+	DCU_MemoryInt requested_memory;
+	DCU_MemoryInt releases;
+	DCU_MemoryInt released_memory;
+	DCU_ContextRollup rollup; // node and subtree, set by DCU_rollupContext
+	bool site; // frame is a DCU_Site descriptor
+};
 
-		memory_space = create_mspace(0, 0);
-		DCU_SET_FLAG(DCU_INITIALIZED);
+struct DCU_StackEntry
+{
+	DCU_ConstPointer const* frames; // innermost first
+	unsigned int depth;
+	bool site; // the only frame is a DCU_Site descriptor
+	DCU_ContextNode* context;
+};
 
-		//
-		// init backtrace so it wont recursively call malloc
-		//
-		DCU_Pointer stack[DCU_STACK_TRACE_SIZE];
-		backtrace(stack, DCU_STACK_TRACE_SIZE);
+struct DCU_StackStripe
+{
+	pthread_mutex_t mutex;
+	DCU_StackEntry* directory[DCU_STACK_DIRECTORY_SIZE];
+	unsigned int count;
+	DCU_StackId* index; // 0 is an empty slot
+	unsigned int index_capacity;
+	DCU_ConstPointer* arena;
+	unsigned int arena_left; // frames
+} __attribute__((aligned(DCU_CACHE_LINE_SIZE)));
 
-		//
-		// Init Tracing data
-		//
+/*
+ * DCU_Shard
+ * 		Tracker state for a slice of the address space.
+ * 		Every shard owns the operations whose address hashes to it,
+ * 		so requests and releases on different shards never share a lock or a cache line.
+ * 		Stats and problems are merged into the global ones by DCU_analyzeMemory.
+ */
+#ifndef DCU_SHARD_COUNT
+#define DCU_SHARD_COUNT 16
+#endif //DCU_SHARD_COUNT
 
-		DCU_stream = DCU_FALLBACK_STREAM;
-		memset(DCU_memory_stats, 0, sizeof(DCU_MemoryStats) * DCU_DYNAMIC_OPERATION_TYPES);
-		memset(&DCU_memory_stats_new, 0, sizeof(DCU_MemoryStats));
-		memset(&DCU_memory_stats_new_array, 0, sizeof(DCU_MemoryStats));
-		memset(&DCU_memory_stats_c, 0, sizeof(DCU_MemoryStats));
-		memset(DCU_null_stack, 0, sizeof(DCU_null_stack));
+struct DCU_InlineHeader;
 
-		//
-		// Operations HashTable
-		//
-		DCU_memory = (DCU_OperationInfo**) DCU_malloc( DCU_HASH_TABLE_SIZE * sizeof(DCU_OperationInfo*) );
-		memset(DCU_memory, 0, DCU_HASH_TABLE_SIZE * sizeof(DCU_OperationInfo*));
+struct DCU_Shard
+{
+	pthread_mutex_t mutex;
+#ifdef DCU_INLINE_HEADERS
+	DCU_InlineHeader* blocks;
+#else
+	DCU_OperationTable memory;
+#endif //DCU_INLINE_HEADERS
+	DCU_ProblemRegistry problems;
+	DCU_MemoryStats memory_stats[DCU_DYNAMIC_OPERATION_TYPES];
+	DCU_MemoryInt live_blocks;
+	DCU_MemoryInt peak_blocks;
+} __attribute__((aligned(DCU_CACHE_LINE_SIZE)));
 
-		//
-		// Problems Linked-List
-		//
-		DCU_problems = 0;
+#define DCU_TRACING				2
+#define DCU_FINISHED			4
 
-		//
-		// Open Log File
-		//
-		DCU_stream = fopen(DCU_OUTPUT_FILE, "w");
-		if (DCU_stream < 0)
-		{
-			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp: Unable to open %s: %m\n", DCU_OUTPUT_FILE);
-			DCU_stream = DCU_FALLBACK_STREAM;
-		}
-		else
-		{
-			int flags = fcntl(fileno(DCU_stream), F_GETFD, 0);
-			if (flags >= 0)
-			{
-				flags |= FD_CLOEXEC;
-				fcntl(fileno(DCU_stream), F_SETFD, flags);
-			}
+#define DCU_SET_FLAG(flag) __atomic_fetch_or(&DCU_flags, flag, __ATOMIC_RELEASE)
+#define DCU_CLEAR_FLAG(flag) __atomic_fetch_and(&DCU_flags, ~flag, __ATOMIC_RELEASE)
+#define DCU_STATE(flag) (__atomic_load_n(&DCU_flags, __ATOMIC_RELAXED) & flag)
 
-			setvbuf(DCU_stream, stream_trace_buffer, _IOFBF, DCU_STREAM_BUFFER_SIZE);
-		}
+//
+// the tracker thread and its creation don't show up on the report
+//
+#ifdef DCU_ASYNC_TRACKING
+#define DCU_THREAD_TRACING (DCU_STATE(DCU_TRACING) && !DCU_untraced_thread)
+#else
+#define DCU_THREAD_TRACING DCU_STATE(DCU_TRACING)
+#endif //DCU_ASYNC_TRACKING
 
-		DCU_SET_FLAG(DCU_TRACING);
-	}
+#define DCU_OUTPUT_FILE "memory_check_up.txt"
+#define DCU_FALLBACK_STREAM stdout
 
-	DCU_write("DynamicCheckUp Started\n");
-}
+/*
+ * DCU_SAMPLE_INTERVAL_VARIABLE
+ * 		Sampling, the DCU_SAMPLE_INTERVAL environment variable sets the mean number of requested bytes
+ * 		between two tracked requests of "sampled" threads (default DCU_SAMPLE_DEFAULT_INTERVAL), when it
+ * 		is set and not 0 every thread is sampled unless DCU_THREAD_POLICY says otherwise.
+ * 		Every thread counts requested bytes down from a distance drawn from an exponential distribution,
+ * 		the request that crosses zero is tracked.
+ * 		A request of n bytes is sampled with probability 1 - exp(-n / interval), stats, calling contexts
+ * 		and leaks count every sampled request as 1 / probability requests to stay unbiased.
+ */
+#define DCU_SAMPLE_INTERVAL_VARIABLE "DCU_SAMPLE_INTERVAL"
+#define DCU_SAMPLE_DEFAULT_INTERVAL 524288
 
-void DCU_shutdown()
+/*
+ * DCU_THREAD_POLICY_VARIABLE
+ * 		Per-thread tracking policies (DCU_TrackingPolicy), set by the thread with DCU_setThreadPolicy or
+ * 		matched on its name by the DCU_THREAD_POLICY environment variable, "pattern=policy,..." with
+ * 		fnmatch patterns, on the thread's first request. Every pthread_setname_np bumps a names generation,
+ * 		threads whose policy was resolved on an older one match their name again on their next request
+ * 		(names set with prctl aren't seen). A policy set with DCU_setThreadPolicy is kept.
+ * 		"full" tracks every request, "sampled" tracks the requests picked by byte sampling, "counters"
+ * 		only counts requests and releases, "untracked" skips the tracker. Counted blocks end with a
+ * 		DCU_CountedTrailer, their release is counted with the size of their request by any thread.
+ * 		Tracked chunks are marked with the dlmalloc FLAG4_BIT, once a request isn't tracked the releases of
+ * 		unmarked chunks skip the tracker too, so a block is checked by the tracker it was requested from
+ * 		whatever the policy of the releasing thread (a release is checked when its chunk isn't in use).
+ * 		Between DCU_suppressBegin and DCU_suppressEnd the requests of a thread aren't tracked, whatever its policy.
+ */
+#define DCU_THREAD_POLICY_VARIABLE "DCU_THREAD_POLICY"
+#define DCU_THREAD_POLICY_RULES 16
+#define DCU_THREAD_POLICY_PATTERN_SIZE 32
+
+#define DCU_TRACKING_POLICIES 4
+static const char* DCU_TrackingPolicyNames[] =
 {
-	if (!DCU_STATE(DCU_FINISHED))
-	{
-		{
-			DCU_MutexScopedLock lock(DCU_mutex);
-			DCU_CLEAR_FLAG(DCU_TRACING);
+		"full",
+		"counters",
+		"sampled",
+		"untracked"
+};
 
-			DCU_analyzeMemory();
-			DCU_reportMemoryStatus();
+//
+// last bytes of the chunk of a counted block, the magic tells counted blocks from untracked ones
+//
+struct DCU_CountedTrailer
+{
+	DCU_MemoryInt size;
+	DCU_MemoryInt magic;
+};
 
-			DCU_emptyMemory();
-			DCU_free(DCU_memory);
+#define DCU_COUNTED_MAGIC(p) (((DCU_MemoryInt)(p) >> 4) ^ 0x4443554354524CUL)
 
-			DCU_emptyProblemList(&DCU_problems);
-		}
+struct DCU_ThreadPolicyRule
+{
+	char pattern[DCU_THREAD_POLICY_PATTERN_SIZE];
+	DCU_TrackingPolicy policy;
+};
 
-		if (DCU_stream != DCU_FALLBACK_STREAM)
-		{
-			fclose(DCU_stream);
-			DCU_stream = DCU_FALLBACK_STREAM;
-		}
+/*
+ * DCU_SiteProfileMode
+ * 		Two-pass stack capture, the DCU_SITE_PROFILE environment variable names the profile file.
+ * 		When the file doesn't exist the run records: stacks keep only the caller of the hook and the
+ * 		callers found on the problems are written to the profile at shutdown, as module offsets.
+ * 		When it exists the run replays it: callers are resolved against the loaded modules at startup and
+ * 		only requests and releases from those callers capture full stacks.
+ * 		Callers in modules loaded after startup (dlopen) aren't resolved.
+ */
+#define DCU_SITE_PROFILE_VARIABLE "DCU_SITE_PROFILE"
+#define DCU_SITE_PROFILE_CAPACITY 4096 // power of two, at most half of it is used
+#define DCU_SITE_PROFILE_LINE_SIZE 4096
 
-		pthread_mutex_destroy(&DCU_mutex);
-		DCU_SET_FLAG(DCU_FINISHED);
-	}
-}
+enum DCU_SiteProfileMode
+{
+	DCU_SiteProfileOff,
+	DCU_SiteProfileRecord,
+	DCU_SiteProfileReplay
+};
 
-void* DCU_requestMemory(DCU_DynamicOperationType const& type, size_t size, void* pointer)
+static const char* DCU_SiteProfileModeNames[] =
 {
-	DCU_initialize();
+		"off",
+		"record",
+		"replay"
+};
 
-	void* out = 0;
-//	DCU_write("Request Type: %d Size:\t%d", type, size);
+struct DCU_SiteModule
+{
+	DCU_MemoryInt address; // looked up when name is null
+	char const* name;
+	DCU_MemoryInt base;
+	bool found;
+};
 
-	if (!size && ((type == DCU_CallocType) || (type == DCU_MallocType) || (type == DCU_NewType) || (type == DCU_NewArrayType)))
-	{
-		DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE];
-		DCU_createStackTrace(stack);
+/*
+ * DCU_UnwinderType
+ * 		How stacks are captured, chosen at startup with the DCU_UNWINDER environment variable.
+ * 		"backtrace" (default) uses glibc backtrace and the DWARF unwinder.
+ * 		"frame-pointer" follows the saved frame pointers, the application and DynamicCheckUp must be
+ * 		built with -fno-omit-frame-pointer. Every frame must be aligned, above the previous one and
+ * 		inside the thread's stack. Code built without frame pointers (like the C library startup) ends
+ * 		the chain early, a chain shorter than DCU_FRAME_POINTER_MIN_FRAMES doesn't reach the application
+ * 		and the stack is captured again with backtrace.
+ * 		"dwarf" unwinds with the call frame information of every module, see DCU_UnwindRule.
+ */
+#define DCU_UNWINDER_VARIABLE "DCU_UNWINDER"
+#define DCU_FRAME_POINTER_MIN_FRAMES 3 // the hook, the operator and their caller
 
-		if (DCU_STATE(DCU_TRACING))
-		{
-			DCU_MutexScopedLock lock(DCU_mutex);
-			DCU_ProblemInfo* problem = DCU_findProblem(&DCU_problems, DCU_RequestZeroMemoryType, stack, DCU_null_stack);
-			if (!problem)
-			{
-				problem = DCU_createProblem();
-				problem->type = DCU_RequestZeroMemoryType;
-				memcpy(problem->allocation_stack, stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-				DCU_addProblemToList(&DCU_problems, problem);
-			}
+enum DCU_UnwinderType
+{
+	DCU_BacktraceUnwinder,
+	DCU_FramePointerUnwinder,
+	DCU_DwarfUnwinder
+};
 
-			problem->count += 1;
-		}
+#define DCU_UNWINDER_TYPES 3
+static const char* DCU_UnwinderTypeNames[] =
+{
+		"backtrace",
+		"frame-pointer",
+		"dwarf"
+};
 
-		return out;
+enum DCU_StackRangeState
+{
+	DCU_StackRangeUnknown,
+	DCU_StackRangeResolving,
+	DCU_StackRangeKnown,
+	DCU_StackRangeUnavailable
+};
+
+/*
+ * DCU_UnwindRule
+ * 		"dwarf" unwinder, for x86-64 code built without frame pointers.
+ * 		Loaded modules and their .eh_frame_hdr search tables are found with dl_iterate_phdr, modules
+ * 		loaded later are added when one of their addresses is first seen.
+ * 		The CFI program of a function is run up to the return address once and reduced to a rule
+ * 		(how to find the CFA, the return address and the caller's rbp). Rules are kept on a per-thread
+ * 		cache keyed by address, so hot stacks are unwound without reading .eh_frame again.
+ * 		Frames described by DWARF expressions (signal trampolines, PLT entries) end the stack.
+ */
+#define DCU_UNWIND_MODULES 512
+#define DCU_UNWIND_CACHE_SIZE 128 // per thread, power of two
+#define DCU_UNWIND_STATE_DEPTH 8 // DW_CFA_remember_state nesting
+#define DCU_UNWIND_RBP 6
+#define DCU_UNWIND_RSP 7
+#define DCU_UNWIND_WORD ((DCU_SignedMemoryInt) sizeof(DCU_MemoryInt))
+
+//
+// DWARF call frame instructions and .eh_frame pointer encodings
+//
+#define DCU_CFA_NOP 0x00
+#define DCU_CFA_SET_LOC 0x01
+#define DCU_CFA_ADVANCE_LOC1 0x02
+#define DCU_CFA_ADVANCE_LOC2 0x03
+#define DCU_CFA_ADVANCE_LOC4 0x04
+#define DCU_CFA_OFFSET_EXTENDED 0x05
+#define DCU_CFA_RESTORE_EXTENDED 0x06
+#define DCU_CFA_UNDEFINED 0x07
+#define DCU_CFA_SAME_VALUE 0x08
+#define DCU_CFA_REGISTER 0x09
+#define DCU_CFA_REMEMBER_STATE 0x0A
+#define DCU_CFA_RESTORE_STATE 0x0B
+#define DCU_CFA_DEF_CFA 0x0C
+#define DCU_CFA_DEF_CFA_REGISTER 0x0D
+#define DCU_CFA_DEF_CFA_OFFSET 0x0E
+#define DCU_CFA_DEF_CFA_EXPRESSION 0x0F
+#define DCU_CFA_EXPRESSION 0x10
+#define DCU_CFA_OFFSET_EXTENDED_SF 0x11
+#define DCU_CFA_DEF_CFA_SF 0x12
+#define DCU_CFA_DEF_CFA_OFFSET_SF 0x13
+#define DCU_CFA_VAL_OFFSET 0x14
+#define DCU_CFA_VAL_OFFSET_SF 0x15
+#define DCU_CFA_VAL_EXPRESSION 0x16
+#define DCU_CFA_GNU_ARGS_SIZE 0x2E
+#define DCU_CFA_GNU_NEGATIVE_OFFSET_EXTENDED 0x2F
+#define DCU_CFA_ADVANCE_LOC 0x40
+#define DCU_CFA_OFFSET 0x80
+#define DCU_CFA_RESTORE 0xC0
+
+#define DCU_PE_ABSPTR 0x00
+#define DCU_PE_ULEB128 0x01
+#define DCU_PE_UDATA2 0x02
+#define DCU_PE_UDATA4 0x03
+#define DCU_PE_UDATA8 0x04
+#define DCU_PE_SLEB128 0x09
+#define DCU_PE_SDATA2 0x0A
+#define DCU_PE_SDATA4 0x0B
+#define DCU_PE_SDATA8 0x0C
+#define DCU_PE_PCREL 0x10
+#define DCU_PE_DATAREL 0x30
+#define DCU_PE_INDIRECT 0x80
+#define DCU_PE_OMIT 0xFF
+
+enum DCU_UnwindRuleStatus
+{
+	DCU_UnwindRuleUnsupported,
+	DCU_UnwindRuleValid,
+	DCU_UnwindRuleEnd
+};
+
+struct DCU_UnwindRule
+{
+	int cfa_offset;
+	unsigned char cfa_register; // DCU_UNWIND_RSP or DCU_UNWIND_RBP
+	signed char return_offset; // words from the CFA
+	signed char frame_offset; // words from the CFA where the caller's rbp was saved, 0 when unchanged
+	unsigned char status; // DCU_UnwindRuleStatus
+};
+
+struct DCU_UnwindCacheEntry
+{
+	DCU_MemoryInt pc; // 0 is an empty entry
+	DCU_UnwindRule rule;
+};
+
+struct DCU_UnwindModule
+{
+	DCU_MemoryInt begin;
+	DCU_MemoryInt end;
+	unsigned char const* frame_header; // .eh_frame_hdr
+	int loaded; // cleared when the module is no longer reported by dl_iterate_phdr
+};
+
+enum DCU_RegisterRule
+{
+	DCU_RegisterSame,
+	DCU_RegisterOffset,
+	DCU_RegisterUndefined,
+	DCU_RegisterUnsupported
+};
+
+struct DCU_CallFrameState
+{
+	unsigned int cfa_register;
+	DCU_SignedMemoryInt cfa_offset;
+	bool cfa_expression;
+	DCU_RegisterRule frame_rule;
+	DCU_SignedMemoryInt frame_offset;
+	DCU_RegisterRule return_rule;
+	DCU_SignedMemoryInt return_offset;
+};
+
+struct DCU_CommonInformation
+{
+	DCU_MemoryInt code_alignment;
+	DCU_SignedMemoryInt data_alignment;
+	DCU_MemoryInt return_register;
+	unsigned char pointer_encoding;
+	bool augmentation_data;
+	unsigned char const* instructions;
+	unsigned char const* instructions_end;
+};
+
+
+/*
+ * DCU_InlineHeader
+ * 		With DCU_INLINE_HEADERS every block is requested with a 32 byte header in front of it, holding
+ * 		the size, type and stack id of the operation and the links of its shard's list of live blocks.
+ * 		Operations are unpacked to a DCU_OperationInfo when they leave the list.
+ * 		A release only reads the header of a pointer inside the range mapped for the mspaces, and the
+ * 		header of a block at the start of a page only after checking the previous page is mapped.
+ * 		The magic (salted with the header address) is only valid while the block is on a list, so
+ * 		foreign pointers and double releases still show up as DCU_ReleaseUnallocatedType.
+ */
+#ifdef DCU_INLINE_HEADERS
+
+#ifdef DCU_LOCK_FREE_TABLE
+#error "DCU_INLINE_HEADERS and DCU_LOCK_FREE_TABLE can't be used together"
+#endif //DCU_LOCK_FREE_TABLE
+
+#define DCU_INLINE_MAGIC(header) ( (unsigned int) (DCU_MemoryInt(header) >> 4) ^ 0x44435548U )
+#define DCU_INLINE_PAGE_SIZE 4096
+
+struct DCU_InlineHeader
+{
+	DCU_InlineHeader* next; // next live block of the shard
+	DCU_InlineHeader** previous; // link pointing at this header
+	DCU_MemoryInt size : 48;
+	DCU_MemoryInt type : 4;
+	DCU_MemoryInt sampled : 1;
+	DCU_MemoryInt alignment_shift : 6; // aligned requests pad their chunk to 1 << alignment_shift, 0 otherwise
+	DCU_StackId stack;
+	unsigned int magic;
+} __attribute__((aligned(MALLOC_ALIGNMENT))); // blocks keep the allocator alignment
+
+#define DCU_BLOCK_HEADER_SIZE sizeof(DCU_InlineHeader)
+
+#else
+
+#define DCU_BLOCK_HEADER_SIZE 0
+
+#endif //DCU_INLINE_HEADERS
+
+/*
+ * DCU_LockFreeSlot
+ * 		Open addressing slot of the lock-free allocation table.
+ * 		A slot is claimed by swapping its key from empty (or tombstone) to the block address,
+ * 		and released by swapping its value to null before the key becomes a tombstone,
+ * 		so only one of two concurrent releases of the same block gets the operation.
+ * 		A tombstone followed by an empty slot ends no probe chain and is emptied again, lookups
+ * 		that stop on an empty slot while that happens retry, and inserts re-mark any empty slot
+ * 		found in their own chain.
+ * 		When DCU_LOCK_FREE_MAX_PROBE slots are busy the operation goes to the shard buckets,
+ * 		which are only searched while DCU_lock_free_overflow counts operations in them.
+ */
+#ifdef DCU_LOCK_FREE_TABLE
+
+#ifndef DCU_LOCK_FREE_TABLE_BITS
+#define DCU_LOCK_FREE_TABLE_BITS 22
+#endif //DCU_LOCK_FREE_TABLE_BITS
+
+#define DCU_LOCK_FREE_TABLE_SIZE (HastIterator(1) << DCU_LOCK_FREE_TABLE_BITS)
+#define DCU_LOCK_FREE_MAX_PROBE ( (DCU_LOCK_FREE_TABLE_SIZE < 4096) ? DCU_LOCK_FREE_TABLE_SIZE : 4096 )
+#define DCU_LOCK_FREE_EMPTY_KEY ((DCU_ConstPointer) 0)
+#define DCU_LOCK_FREE_TOMBSTONE_KEY ((DCU_ConstPointer) 1)
+#define DCU_LOCK_FREE_HASH_FUNCTION(address) \
+	( HastIterator((DCU_MemoryInt(address) >> 4) * 0x9E3779B97F4A7C15ULL) >> (sizeof(HastIterator) * 8 - DCU_LOCK_FREE_TABLE_BITS) )
+
+struct DCU_LockFreeSlot
+{
+	DCU_ConstPointer key;
+	DCU_OperationInfo* value;
+};
+
+static DCU_LockFreeSlot* DCU_lock_free_table;
+static DCU_MemoryInt DCU_lock_free_overflow; // operations in the shard buckets
+static DCU_MemoryInt DCU_lock_free_overflowed; // total operations that went to the shard buckets
+static unsigned int DCU_lock_free_reclaim_sequence; // odd while tombstones are being emptied
+
+#endif //DCU_LOCK_FREE_TABLE
+
+#ifndef DCU_PASSTHROUGH
+static mspace memory_space;
+#endif //DCU_PASSTHROUGH
+
+/*
+ * metadata_space
+ * 		Tracker records (operations, problems, operation tables) are kept away from the application blocks,
+ * 		so they don't share cache lines with user data or fragment the heap being measured.
+ */
+static mspace metadata_space;
+#define DCU_metadataMalloc(size) mspace_malloc(metadata_space, size)
+#define DCU_metadataFree(p) mspace_free(metadata_space, p)
+
+/*
+ * DCU_SlabAllocator
+ * 		Fixed size records are carved from DCU_SLAB_SIZE slabs of the metadata space and never
+ * 		returned to it. Every thread keeps two magazines of free records per allocator, so creating
+ * 		or destroying a record is a pointer pop or push. Only when both magazines are empty (or full)
+ * 		the thread goes to the depot, under the allocator lock, and exchanges a whole magazine.
+ * 		The magazines of a finished thread are returned to the depot.
+ * 		When the metadata space can't provide a magazine, records are taken from and given back to
+ * 		the shared slab one at a time under the allocator lock, loose records are linked through their
+ * 		first word.
+ */
+#define DCU_SLAB_SIZE (64 * 1024)
+#define DCU_MAGAZINE_SIZE 64
+
+struct DCU_Magazine
+{
+	DCU_Magazine* next;
+	unsigned int count;
+	DCU_Pointer records[DCU_MAGAZINE_SIZE];
+};
+
+struct DCU_SlabAllocator
+{
+	pthread_mutex_t mutex;
+	size_t record_size;
+	DCU_Magazine* full;
+	DCU_Magazine* empty;
+	DCU_Pointer loose;
+	char* slab;
+	char* slab_end;
+};
+
+struct DCU_MagazineCache
+{
+	DCU_Magazine* loaded;
+	DCU_Magazine* previous;
+};
+
+static DCU_SlabAllocator DCU_operation_slabs = { PTHREAD_MUTEX_INITIALIZER, sizeof(DCU_OperationInfo), 0, 0, 0, 0, 0 };
+static DCU_SlabAllocator DCU_problem_slabs = { PTHREAD_MUTEX_INITIALIZER, sizeof(DCU_ProblemInfo), 0, 0, 0, 0, 0 };
+static DCU_THREAD_LOCAL DCU_MagazineCache DCU_operation_cache;
+static DCU_THREAD_LOCAL DCU_MagazineCache DCU_problem_cache;
+static DCU_THREAD_LOCAL bool DCU_magazines_registered;
+static pthread_key_t DCU_magazine_key;
+
+/*
+ * DCU_ASYNC_TRACKING
+ * 		Requests capture their stack and push a DCU_Event on the calling thread's ring, releases only
+ * 		push the event, a tracker thread drains every ring in batches and applies the events to the shards.
+ * 		Reallocs copy the old block, so they take it off the table themselves, waiting for their own ring,
+ * 		then for every ring, to go past the request that created it when it isn't there yet.
+ * 		Released blocks are checked and given back to the allocator by the tracker thread, so their
+ * 		address can't be reused before the release is applied.
+ * 		A release pushed on one ring may be drained before the request, pushed on another ring, that
+ * 		created the block. Such releases are retried for DCU_ASYNC_RETRY_ROUNDS drains before they are
+ * 		reported as unallocated. ABORT_ON flags abort from the tracker thread once the release is applied.
+ * 		When a ring is full the thread waits for the tracker, or with DCU_ASYNC_OVERFLOW_SPILL applies
+ * 		the event itself under the shard locks. Both cases are counted as ring overflows.
+ */
+#ifdef DCU_ASYNC_TRACKING
+
+#ifndef DCU_EVENT_RING_SIZE
+#define DCU_EVENT_RING_SIZE 4096 //power of two
+#endif //DCU_EVENT_RING_SIZE
+
+#define DCU_ASYNC_RETRY_ROUNDS 16
+#define DCU_ASYNC_IDLE_SLEEP 200 //microseconds
+
+struct DCU_Event
+{
+	DCU_ConstPointer memory_address;
+	DCU_OperationInfo* operation; // null on releases
+	DCU_DynamicOperationType type;
+	size_t size; // size given to a sized release, 0 otherwise
+};
+
+struct DCU_EventRing
+{
+	DCU_EventRing* next;
+	bool released;
+	DCU_MemoryInt head __attribute__((aligned(DCU_CACHE_LINE_SIZE)));
+	DCU_MemoryInt tail __attribute__((aligned(DCU_CACHE_LINE_SIZE)));
+	DCU_Event events[DCU_EVENT_RING_SIZE];
+};
+
+struct DCU_PendingRelease
+{
+	DCU_PendingRelease* next;
+	DCU_ConstPointer memory_address;
+	DCU_DynamicOperationType type;
+	unsigned int rounds;
+	size_t size;
+};
+
+enum DCU_TrackerState
+{
+	DCU_TrackerStopped,
+	DCU_TrackerStarting,
+	DCU_TrackerRunning,
+	DCU_TrackerStopping,
+	DCU_TrackerSynchronous // thread creation failed or shutdown, events are applied by the caller
+};
+
+static pthread_mutex_t DCU_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DCU_EventRing* DCU_rings;
+static DCU_THREAD_LOCAL DCU_EventRing* DCU_thread_ring;
+static DCU_THREAD_LOCAL bool DCU_untraced_thread;
+static pthread_key_t DCU_ring_key;
+static pthread_mutex_t DCU_pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DCU_PendingRelease* DCU_pending_releases;
+static pthread_t DCU_tracker_thread;
+static int DCU_tracker_state;
+static int DCU_ring_waiters; // threads in DCU_waitRing, the tracker doesn't sleep while there are any
+static DCU_MemoryInt DCU_ring_overflows;
+
+#endif //DCU_ASYNC_TRACKING
+
+/*
+ * DCU_MappedRegion
+ * 		With DCU_MMAP_TRACKING anonymous mappings are kept apart from the heap blocks, on an array
+ * 		of regions sorted by address. munmap trims or splits the regions it covers (a region left in
+ * 		pieces is reported as DCU_PartialUnmapType), mremap moves the region with its stack.
+ * 		Regions still mapped at shutdown are reported as DCU_MappingLeakType.
+ */
+#ifdef DCU_MMAP_TRACKING
+
+#define DCU_MAPPING_OPERATION_TYPES 3
+#define DCU_MAPPINGS_INITIAL_CAPACITY 64
+
+enum DCU_MappingOperationType
+{
+	DCU_MmapType,
+	DCU_MunmapType,
+	DCU_MremapType
+};
+
+static const char* DCU_MappingOperationNames[] =
+{
+		"mmap",
+		"munmap",
+		"mremap"
+};
+
+struct DCU_Mapping
+{
+	DCU_StackId stack;
+	DCU_MemoryInt length; // bytes still mapped
+	unsigned int regions;
+	unsigned int unmapping; // regions taken off by the running DCU_removeRegions
+	bool reported;
+};
+
+struct DCU_MappedRegion
+{
+	DCU_MemoryInt start;
+	DCU_MemoryInt end;
+	DCU_Mapping* mapping;
+};
+
+static pthread_mutex_t DCU_mappings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DCU_MappedRegion* DCU_regions;
+static unsigned int DCU_regions_count;
+static unsigned int DCU_regions_capacity;
+static DCU_MemoryInt DCU_mappings_count; // mappings with regions left
+static DCU_MemoryInt DCU_mapped_bytes;
+static DCU_MemoryInt DCU_page_size; // read once on DCU_initialize()
+static DCU_MemoryStats DCU_mapping_stats[DCU_MAPPING_OPERATION_TYPES];
+
+#endif //DCU_MMAP_TRACKING
+
+/*
+ * DCU_bootstrap_arena
+ * 		Static arena for the requests made while the tracker initializes, blocks are bump allocated,
+ * 		keep their size in front of them and are never reused. Releases of arena blocks are ignored
+ * 		and reallocations move them to the memory space.
+ */
+#define DCU_BOOTSTRAP_ARENA_SIZE (64 * 1024)
+
+static char DCU_bootstrap_arena[DCU_BOOTSTRAP_ARENA_SIZE] __attribute__((aligned(16)));
+static size_t DCU_bootstrap_arena_used;
+
+void* DCU_bootstrapMalloc(size_t size, size_t alignment);
+void* DCU_bootstrapRequest(size_t size, void* pointer, size_t const alignment);
+void* DCU_leaveBootstrapArena(size_t size, void* pointer, DCU_ConstPointer const caller);
+size_t DCU_bootstrapSize(void* p);
+bool DCU_inBootstrapArena(void* p);
+
+/*
+ * DCU_PASSTHROUGH
+ * 		User blocks are requested from the next allocator in the lookup order, only the tracker records
+ * 		stay on dlmalloc. The next allocator is resolved during initialization, what dlsym requests
+ * 		comes from the bootstrap arena.
+ * 		A pointer missing from the table (requested before the tracker, untracked, or not a block at all)
+ * 		is handed to the next allocator's free or realloc as it is, the next allocator decides what
+ * 		an invalid one means, as it would without the tracker.
+ */
+#ifdef DCU_PASSTHROUGH
+
+#ifdef DCU_THREAD_MSPACES
+#error "DCU_PASSTHROUGH can't be combined with DCU_THREAD_MSPACES"
+#endif //DCU_THREAD_MSPACES
+
+#ifdef DCU_INLINE_HEADERS
+#error "DCU_PASSTHROUGH can't be combined with DCU_INLINE_HEADERS"
+#endif //DCU_INLINE_HEADERS
+
+struct DCU_NextAllocator
+{
+	void* (*malloc)(size_t);
+	void (*free)(void*);
+	void* (*realloc)(void*, size_t);
+	void* (*calloc)(size_t, size_t);
+	void* (*memalign)(size_t, size_t);
+	size_t (*usable_size)(void*);
+};
+
+static DCU_NextAllocator DCU_next_allocator;
+
+void DCU_resolveNextAllocator();
+
+#define DCU_malloc(size) DCU_next_allocator.malloc(size)
+#define DCU_free(p) DCU_next_allocator.free(p)
+#define DCU_realloc(p, size) DCU_next_allocator.realloc(p, size)
+#define DCU_calloc(nmemb, size) DCU_next_allocator.calloc(nmemb, size)
+#define DCU_memalign(alignment, bytes) DCU_next_allocator.memalign(alignment, bytes)
+#define DCU_usableSize(p) DCU_next_allocator.usable_size(p)
+
+#elif defined(DCU_THREAD_MSPACES)
+
+/*
+ * DCU_THREAD_MSPACES
+ * 		Every thread requests memory from its own mspace, created on its first request and
+ * 		cached in thread local storage, so threads don't contend on a single dlmalloc lock.
+ * 		With FOOTERS each chunk knows its mspace, so a release from any thread goes to the owner.
+ * 		Thread mspaces are never destroyed, a finished thread hands its mspace to the next new thread.
+ */
+#define DCU_MAX_THREAD_SPACES 1024
+
+static pthread_mutex_t DCU_thread_spaces_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t DCU_thread_space_key;
+static mspace DCU_thread_spaces[DCU_MAX_THREAD_SPACES];
+static bool DCU_thread_space_used[DCU_MAX_THREAD_SPACES];
+static unsigned int DCU_thread_spaces_count;
+static DCU_THREAD_LOCAL mspace DCU_thread_space;
+
+mspace DCU_getThreadSpace();
+mspace DCU_acquireThreadSpace();
+void DCU_releaseThreadSpace(void* space);
+
+//
+// chunks are released to the mspace named on their footer, whichever thread releases them
+//
+#define DCU_ownerSpace(p) ((p) ? (mspace) get_mstate_for(mem2chunk(p)) : memory_space)
+
+#define DCU_malloc(size) mspace_malloc(DCU_getThreadSpace(), size)
+#define DCU_free(p) mspace_free(DCU_ownerSpace(p), p)
+#define DCU_realloc(p, size) mspace_realloc(DCU_getThreadSpace(), p, size)
+#define DCU_calloc(nmemb, size) mspace_calloc(DCU_getThreadSpace(), nmemb, size)
+#define DCU_memalign(alignment, bytes) mspace_memalign(DCU_getThreadSpace(), alignment, bytes)
+#define DCU_usableSize(p) mspace_usable_size(p)
+
+#else
+
+#define DCU_malloc(size) mspace_malloc(memory_space, size)
+#define DCU_free(p) mspace_free(memory_space, p)
+#define DCU_realloc(p, size) mspace_realloc(memory_space, p, size)
+#define DCU_calloc(nmemb, size) mspace_calloc(memory_space, nmemb, size)
+#define DCU_memalign(alignment, bytes) mspace_memalign(memory_space, alignment, bytes)
+#define DCU_usableSize(p) mspace_usable_size(p)
+
+#endif //DCU_PASSTHROUGH
+
+//
+// User blocks, DCU_BLOCK_HEADER_SIZE bytes in front of them belong to the tracker
+//
+#define DCU_blockMalloc(size) DCU_toBlock(DCU_malloc((size) + DCU_BLOCK_HEADER_SIZE))
+#ifdef DCU_INLINE_HEADERS
+#define DCU_blockStart(p) ((char*)(p) - DCU_BLOCK_HEADER_SIZE - DCU_headerPadding(DCU_getInlineHeader(p)))
+#else
+#define DCU_blockStart(p) ((char*)(p))
+#endif //DCU_INLINE_HEADERS
+#define DCU_blockFree(p) DCU_free(DCU_blockStart(p))
+#define DCU_blockUsableSize(p) (DCU_usableSize(DCU_blockStart(p)) - ((char*)(p) - DCU_blockStart(p)))
+#ifdef DCU_PASSTHROUGH
+#define DCU_blockCalloc(size) DCU_toBlock(DCU_calloc(1, (size) + DCU_BLOCK_HEADER_SIZE))
+//
+// chunks of the next allocator can't be marked, a block missing from the table
+// goes back to the next allocator without a report
+//
+#define DCU_markTracked(p) ((void) 0)
+#define DCU_bypassRelease(p) false
+#define DCU_unknownIsUntracked() true
+#else
+#define DCU_blockChunk(p) mem2chunk(DCU_blockStart(p))
+#define DCU_markTracked(p) (DCU_blockChunk(p)->head |= FLAG4_BIT)
+//
+// untracked chunks skip the tracker, chunks that aren't in use or that no mspace holds
+// still go through it to be reported
+//
+#define DCU_bypassRelease(p) (DCU_untracked_blocks && DCU_isUntrackedChunk(p))
+#define DCU_unknownIsUntracked() false
+#endif //DCU_PASSTHROUGH
+
+#define DCU_STREAM_BUFFER_SIZE 512
+static FILE* DCU_stream;
+static char stream_trace_buffer[DCU_STREAM_BUFFER_SIZE];
+
+static pthread_mutex_t DCU_mutex;
+static DCU_THREAD_LOCAL bool DCU_initializing_thread;
+static DCU_Shard DCU_shards[DCU_SHARD_COUNT];
+static DCU_ProblemRegistry DCU_problems;
+
+//
+// the metadata space couldn't provide a record, such blocks are left untracked and such problems unreported
+//
+static DCU_MemoryInt DCU_untracked_requests;
+static DCU_MemoryInt DCU_lost_problems;
+
+static DCU_MemoryStats DCU_memory_stats[DCU_DYNAMIC_OPERATION_TYPES];
+static DCU_MemoryStats DCU_memory_stats_c;
+static DCU_MemoryStats DCU_memory_stats_new;
+static DCU_MemoryStats DCU_memory_stats_new_array;
+
+static DCU_StackEntry DCU_null_stack;
+static unsigned int DCU_stack_depth = DCU_STACK_DEFAULT_DEPTH;
+
+static DCU_StackStripe DCU_stack_stripes[DCU_STACK_STRIPES];
+static DCU_THREAD_LOCAL DCU_StackId DCU_stack_cache[DCU_STACK_CACHE_SIZE];
+
+static DCU_MemoryInt DCU_sample_interval = DCU_SAMPLE_DEFAULT_INTERVAL;
+static bool DCU_untracked_blocks; // set once a request isn't tracked
+static DCU_MemoryStats DCU_counted_stats[DCU_DYNAMIC_OPERATION_TYPES];
+
+static DCU_TrackingPolicy DCU_default_policy = DCU_FullTracking;
+static DCU_ThreadPolicyRule DCU_thread_policy_rules[DCU_THREAD_POLICY_RULES];
+static unsigned int DCU_thread_policy_rules_count;
+static unsigned int DCU_thread_names_generation = 1; // bumped by every pthread_setname_np
+static DCU_THREAD_LOCAL unsigned int DCU_thread_policy_generation; // names generation of the resolved policy, 0 before
+static DCU_THREAD_LOCAL bool DCU_thread_policy_set; // set by DCU_setThreadPolicy, the name no longer matters
+static DCU_THREAD_LOCAL DCU_TrackingPolicy DCU_thread_policy;
+static DCU_THREAD_LOCAL unsigned int DCU_suppress_depth; // DCU_suppressBegin nesting, requests are untracked
+static DCU_THREAD_LOCAL ssize_t DCU_sample_countdown;
+static DCU_THREAD_LOCAL unsigned long long DCU_sample_random; // 0 until the thread's first draw
+
+static DCU_SiteProfileMode DCU_site_profile_mode = DCU_SiteProfileOff;
+static char const* DCU_site_profile_path;
+static DCU_ConstPointer DCU_site_profile[DCU_SITE_PROFILE_CAPACITY]; // callers, read only once tracing starts
+static unsigned int DCU_site_profile_count;
+
+static DCU_UnwinderType DCU_unwinder = DCU_BacktraceUnwinder;
+static DCU_MemoryInt DCU_unwind_fallbacks;
+static DCU_THREAD_LOCAL DCU_MemoryInt DCU_thread_stack_low;
+static DCU_THREAD_LOCAL DCU_MemoryInt DCU_thread_stack_high;
+static DCU_THREAD_LOCAL unsigned char DCU_thread_stack_state;
+static DCU_THREAD_LOCAL DCU_UnwindCacheEntry DCU_unwind_cache[DCU_UNWIND_CACHE_SIZE];
+static pthread_mutex_t DCU_unwind_modules_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DCU_UnwindModule DCU_unwind_modules[DCU_UNWIND_MODULES];
+static unsigned int DCU_unwind_modules_count;
+
+static pthread_mutex_t DCU_context_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DCU_ContextNode DCU_context_root;
+
+//
+// caller is the return address of the hook, stacks start there unless the request has a site
+//
+void* DCU_requestMemory(DCU_DynamicOperationType const& type, size_t size, void* pointer, DCU_ConstPointer const caller,
+		DCU_Site const* site, size_t const alignment);
+//
+// operator new semantics on top of DCU_requestMemory, failed requests call the new handler and throw std::bad_alloc
+//
+void* DCU_requestNewMemory(DCU_DynamicOperationType const& type, size_t size, DCU_ConstPointer const caller,
+		DCU_Site const* site, size_t const alignment);
+void* DCU_requestNothrowMemory(DCU_DynamicOperationType const& type, size_t size, DCU_ConstPointer const caller,
+		size_t const alignment) _GLIBCXX_USE_NOEXCEPT;
+//
+// size is the one given to a sized release (checked against the request), 0 otherwise
+//
+void DCU_releaseMemory(DCU_DynamicOperationType const& type, void* pointer, DCU_ConstPointer const caller, size_t const size);
+void DCU_releaseUntracked(DCU_DynamicOperationType const& type, void* pointer);
+void* DCU_requestAlignedMemory(size_t alignment, size_t size, DCU_ConstPointer const caller);
+size_t DCU_usableMemory(void* pointer);
+
+enum DCU_ReleaseStatus
+{
+	DCU_ReleaseUntraced,
+	DCU_ReleaseTracked,
+	DCU_ReleaseUnallocated
+};
+
+void DCU_trackRequest(DCU_OperationInfo* operation);
+DCU_OperationInfo* DCU_takeOperation(DCU_ConstPointer pointer);
+DCU_ReleaseStatus DCU_trackRelease(DCU_DynamicOperationType const& type, void* pointer, DCU_ConstPointer const caller, size_t const size,
+		char const*& abort_message);
+
+void DCU_analyzeMemory();
+void DCU_mergeShards();
+void DCU_reportMemoryStatus();
+
+DCU_OperationInfo* DCU_createOperation();
+DCU_ProblemInfo* DCU_createProblem();
+void DCU_destroyOperation(DCU_OperationInfo* element);
+void DCU_destroyProblem(DCU_ProblemInfo* element);
+
+//
+// Slab allocator management
+//
+DCU_Pointer DCU_slabAllocate(DCU_SlabAllocator& allocator, DCU_MagazineCache& cache);
+void DCU_slabRelease(DCU_SlabAllocator& allocator, DCU_MagazineCache& cache, DCU_Pointer record);
+DCU_Magazine* DCU_exchangeMagazine(DCU_SlabAllocator& allocator, DCU_Magazine* magazine, bool const want_full);
+DCU_Pointer DCU_slabTake(DCU_SlabAllocator& allocator);
+void DCU_slabPut(DCU_SlabAllocator& allocator, DCU_Pointer record);
+DCU_Pointer DCU_carveRecord(DCU_SlabAllocator& allocator);
+void DCU_depositMagazine(DCU_SlabAllocator& allocator, DCU_Magazine* magazine);
+void DCU_flushMagazines(void*);
+
+#ifdef DCU_ASYNC_TRACKING
+//
+// Asynchronous tracking
+//
+void DCU_pushEvent(DCU_DynamicOperationType const type, DCU_ConstPointer memory_address, DCU_OperationInfo* operation, size_t const size);
+DCU_EventRing* DCU_acquireThreadRing();
+void DCU_releaseThreadRing(void* ring);
+void DCU_startTracker();
+void DCU_stopTracker();
+void* DCU_trackerMain(void*);
+bool DCU_drainEvents();
+void DCU_applyEvent(DCU_Event const& event, char const*& abort_message);
+void DCU_applyEventNow(DCU_Event const& event);
+void DCU_addPendingRelease(DCU_Event const& event);
+void DCU_retryPendingReleases(bool const final_round);
+void DCU_waitThreadRing();
+void DCU_waitRings();
+void DCU_waitRing(DCU_EventRing* ring, DCU_MemoryInt const tail);
+void DCU_releaseTrackedBlock(DCU_ReleaseStatus const status, void* pointer, char const* abort_message);
+void DCU_forkChild();
+#endif //DCU_ASYNC_TRACKING
+
+#ifdef DCU_MMAP_TRACKING
+//
+// Mapped regions, DCU_mappings_mutex must be held by the region list functions
+//
+void DCU_requestMapping(void* address, size_t length, bool const anonymous, DCU_ConstPointer const caller);
+void DCU_releaseMapping(void* address, size_t length, DCU_ConstPointer const caller);
+void DCU_moveMapping(void* old_address, size_t old_length, void* new_address, size_t new_length);
+DCU_MemoryInt DCU_pageRound(size_t length);
+unsigned int DCU_findRegion(DCU_MemoryInt const address);
+bool DCU_reserveRegion();
+bool DCU_insertRegion(DCU_MemoryInt const start, DCU_MemoryInt const end, DCU_Mapping* mapping);
+DCU_MemoryInt DCU_removeRegions(DCU_MemoryInt const start, DCU_MemoryInt const end, DCU_StackId& stack, bool& partial);
+void DCU_dropRegion(DCU_Mapping* mapping);
+void DCU_registerMappingLeaks();
+#endif //DCU_MMAP_TRACKING
+
+//
+// DCU_OperationTable management
+//
+void DCU_tableInitialize(DCU_OperationTable& table, HastIterator const capacity);
+void DCU_tableDestroy(DCU_OperationTable& table);
+void DCU_tableInsert(DCU_OperationTable& table, DCU_OperationInfo* element);
+DCU_OperationInfo* DCU_tableTake(DCU_OperationTable& table, DCU_ConstPointer memory_address);
+size_t DCU_tableFindSize(DCU_OperationTable& table, DCU_ConstPointer memory_address);
+void DCU_tableVisit(DCU_OperationTable& table, void (*visitor)(DCU_OperationInfo*));
+bool DCU_storageAllocate(DCU_TableStorage& storage, HastIterator const capacity);
+void DCU_storageRelease(DCU_TableStorage& storage);
+DCU_MemoryInt DCU_committedBytes(void const* address, size_t const length);
+DCU_MemoryInt DCU_storageCommitted(DCU_TableStorage const& storage);
+void DCU_storageInsert(DCU_TableStorage& storage, DCU_TableSlot const& element, HastIterator const hash, bool& used_empty);
+HastIterator DCU_storageFind(DCU_TableStorage& storage, DCU_ConstPointer memory_address, HastIterator const hash);
+void DCU_storageErase(DCU_TableStorage& storage, HastIterator const index);
+void DCU_tableGrow(DCU_OperationTable& table);
+void DCU_tableMigrate(DCU_OperationTable& table, HastIterator steps);
+unsigned int DCU_groupMatch(signed char const* group, signed char const value);
+unsigned int DCU_groupMatchFree(signed char const* group);
+DCU_ConstPointer DCU_slotAddress(DCU_TableSlot const& slot);
+void DCU_packSlot(DCU_TableSlot& slot, DCU_OperationInfo* element);
+void DCU_unpackSlot(DCU_TableSlot const& slot, DCU_OperationInfo* element);
+
+//
+// Stack table management
+//
+void DCU_initializeStacks();
+DCU_StackId DCU_internStack(DCU_ConstPointer const* stack, unsigned int const depth, bool const site);
+DCU_StackEntry const& DCU_getStack(DCU_StackId const id);
+HastIterator DCU_hashStack(DCU_ConstPointer const* stack, unsigned int const depth);
+void DCU_growStackIndex(DCU_StackStripe& stripe);
+
+//
+// Calling-context tree management
+//
+DCU_ContextNode* DCU_insertContext(DCU_ConstPointer const* stack, unsigned int const depth, bool const site);
+DCU_ContextNode* DCU_findContextChild(DCU_ContextNode* parent, DCU_ConstPointer frame);
+DCU_ContextNode* DCU_getStackContext(DCU_StackId const id);
+void DCU_updateContext(DCU_StackId const stack, size_t const size, DCU_MemoryInt const weight, bool const request);
+DCU_ContextRollup const& DCU_rollupContext(DCU_ContextNode* node);
+void DCU_reportContext(DCU_ContextNode const* node, unsigned int const depth, DCU_MemoryInt const threshold);
+
+//
+// DCU_ProblemRegistry Management
+//
+void DCU_initializeProblems(DCU_ProblemRegistry& registry);
+void DCU_emptyProblems(DCU_ProblemRegistry& registry);
+DCU_ProblemInfo* DCU_takeProblems(DCU_ProblemRegistry& registry);
+void DCU_addProblem(DCU_ProblemRegistry& registry, DCU_ProblemInfo* element);
+DCU_ProblemInfo* DCU_findProblem(DCU_ProblemRegistry& registry, DCU_ProblemType const type,
+								DCU_StackId const allocation_stack, DCU_StackId const deallocation_stack);
+HastIterator DCU_hashProblem(DCU_ProblemType const type, DCU_StackId const allocation_stack, DCU_StackId const deallocation_stack);
+void DCU_growProblemIndex(DCU_ProblemRegistry& registry);
+void DCU_registerProblem(DCU_Shard& shard, DCU_ProblemType const type,
+								DCU_StackId const allocation_stack, DCU_StackId const deallocation_stack);
+void DCU_registerLeak(DCU_OperationInfo* operation);
+
+//
+// Shard management
+//
+DCU_Shard& DCU_getShard(DCU_ConstPointer memory_address);
+DCU_Shard& DCU_getThreadShard();
+void DCU_lockShards();
+void DCU_unlockShards();
+void DCU_updateStats(DCU_MemoryStats& stats, size_t size, DCU_MemoryInt const weight, bool const track_max_value);
+void DCU_updateLiveBlocks(DCU_Shard& shard, bool const request);
+
+//
+// Hash table management
+// the shard must be locked with DCU_TableScopedLock
+//
+void DCU_addMemory(DCU_Shard& shard, DCU_OperationInfo* element);
+DCU_OperationInfo* DCU_takeMemory(DCU_Shard& shard, DCU_ConstPointer memory_address);
+size_t DCU_findMemorySize(DCU_Shard& shard, DCU_ConstPointer memory_address);
+void DCU_emptyMemory();
+
+//
+// User block headers
+//
+DCU_Pointer DCU_toBlock(DCU_Pointer chunk);
+DCU_Pointer DCU_blockMemalign(size_t const alignment, size_t const size);
+#ifdef DCU_INLINE_HEADERS
+DCU_InlineHeader* DCU_getInlineHeader(DCU_ConstPointer memory_address);
+DCU_InlineHeader* DCU_findInlineHeader(DCU_ConstPointer memory_address);
+bool DCU_readableBefore(DCU_MemoryInt const address, size_t const length);
+size_t DCU_headerPadding(DCU_InlineHeader const* header);
+void DCU_unpackHeader(DCU_InlineHeader const* header, DCU_OperationInfo* element);
+#endif //DCU_INLINE_HEADERS
+
+#ifdef DCU_LOCK_FREE_TABLE
+bool DCU_addLockFreeMemory(DCU_OperationInfo* element);
+DCU_OperationInfo* DCU_takeLockFreeMemory(DCU_ConstPointer memory_address);
+void DCU_reclaimLockFreeSlots(HastIterator slot);
+size_t DCU_findLockFreeSize(DCU_ConstPointer memory_address);
+#endif //DCU_LOCK_FREE_TABLE
+
+DCU_StackId DCU_createStackTrace(DCU_ConstPointer const caller);
+DCU_StackId DCU_createSiteStack(DCU_Site const* site);
+void DCU_selectUnwinder();
+void DCU_selectStackDepth();
+void DCU_selectSampleInterval();
+bool DCU_sampleRequest(size_t const size);
+bool DCU_drawSample(size_t const size);
+DCU_MemoryInt DCU_operationWeight(DCU_OperationInfo const* operation);
+void DCU_selectThreadPolicies();
+DCU_TrackingPolicy DCU_getThreadPolicy();
+bool DCU_threadChecksProblems();
+void DCU_resolveThreadPolicy();
+void DCU_changeThreadPolicy(DCU_TrackingPolicy const policy);
+bool DCU_admitRequest(size_t const size, bool& sampled);
+void DCU_countOperation(DCU_DynamicOperationType const& type, size_t const size);
+bool DCU_threadCountsRequests();
+DCU_CountedTrailer* DCU_getCountedTrailer(DCU_ConstPointer const memory_address);
+void DCU_markCounted(DCU_ConstPointer const memory_address, size_t const size);
+bool DCU_countRelease(DCU_DynamicOperationType const& type, DCU_ConstPointer const memory_address, size_t& size);
+#ifndef DCU_PASSTHROUGH
+bool DCU_isUntrackedChunk(DCU_ConstPointer const memory_address);
+bool DCU_ownsChunk(mchunkptr const chunk);
+bool DCU_spaceHoldsChunk(mspace const space, mchunkptr const chunk);
+#endif //DCU_PASSTHROUGH
+void DCU_selectSiteProfile();
+void DCU_writeSiteProfile();
+bool DCU_addProfiledCaller(DCU_ConstPointer const caller);
+bool DCU_isProfiledCaller(DCU_ConstPointer const caller);
+int DCU_matchSiteModule(struct dl_phdr_info* info, size_t, void* data);
+bool DCU_walkFramePointers(DCU_ConstPointer* stack, unsigned int const size, unsigned int& depth);
+bool DCU_resolveThreadStack();
+bool DCU_walkCachedFrames(DCU_ConstPointer* stack, unsigned int const size, unsigned int& depth);
+#if defined(__x86_64__)
+DCU_UnwindRule DCU_findUnwindRule(DCU_MemoryInt const pc);
+DCU_UnwindRule DCU_compileUnwindRule(DCU_MemoryInt const pc);
+DCU_UnwindModule const* DCU_findUnwindModule(DCU_MemoryInt const pc);
+int DCU_collectUnwindModule(struct dl_phdr_info* info, size_t, void*);
+bool DCU_findFrameDescription(unsigned char const* frame_header, DCU_MemoryInt const pc, DCU_CommonInformation& common,
+		DCU_MemoryInt& location, unsigned char const*& instructions, unsigned char const*& instructions_end);
+bool DCU_parseCommonInformation(unsigned char const* entry, DCU_CommonInformation& common);
+bool DCU_runCallFrameProgram(unsigned char const* p, unsigned char const* end, DCU_CommonInformation const& common,
+		DCU_MemoryInt location, DCU_MemoryInt const pc, DCU_CallFrameState& state, DCU_CallFrameState const& initial);
+void DCU_setRegisterRule(DCU_CallFrameState& state, DCU_CommonInformation const& common, DCU_MemoryInt const reg,
+		DCU_RegisterRule const rule, DCU_SignedMemoryInt const offset);
+void DCU_restoreRegisterRule(DCU_CallFrameState& state, DCU_CallFrameState const& initial, DCU_CommonInformation const& common,
+		DCU_MemoryInt const reg);
+DCU_MemoryInt DCU_readEncodedPointer(unsigned char const*& p, unsigned char const encoding, DCU_MemoryInt const data_base, bool& valid);
+DCU_MemoryInt DCU_readUnsigned(unsigned char const*& p);
+DCU_SignedMemoryInt DCU_readSigned(unsigned char const*& p);
+#endif //__x86_64__
+bool DCU_stacksMatch(DCU_ConstPointer const* lhs, DCU_ConstPointer const* rhs, unsigned int const depth);
+
+void DCU_abort(char const* message, ...);
+void DCU_write(char const* message, ...);
+
+//
+// Implementation
+//
+
+//
+// runs before the constructors of default priority, the report is written after the atexit handlers
+// registered later and the library destructors
+//
+__attribute__((constructor(101))) static void DCU_bootstrap()
+{
+	DCU_initialize();
+	atexit(DCU_shutdown);
+}
+
+bool DCU_initializeTracker()
+{
+	int state = DCU_InitPending;
+	if (!__atomic_compare_exchange_n(&DCU_init_state, &state, DCU_InitRunning, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		if (state == DCU_InitDone)
+		{
+			return true;
+		}
+
+		//
+		// requests made by the initialization itself
+		//
+		if (DCU_initializing_thread)
+		{
+			return (state == DCU_InitSpacesReady);
+		}
+
+		while (__atomic_load_n(&DCU_init_state, __ATOMIC_ACQUIRE) != DCU_InitDone)
+		{
+			sched_yield();
+		}
+
+		return true;
+	}
+
+	DCU_initializing_thread = true;
+
+	if (pthread_mutex_init(&DCU_mutex, 0) < 0)
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to initialize mutex\n");
+		_exit(1);
+	}
+
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		if (pthread_mutex_init(&DCU_shards[i].mutex, 0) < 0)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to initialize shard mutex\n");
+			_exit(1);
+		}
+	}
+
+
+	{
+		DCU_MutexScopedLock lock(DCU_mutex);
+
+		//
+		// user blocks are requested and released outside of the shard locks
+		//
+#ifdef DCU_PASSTHROUGH
+		DCU_resolveNextAllocator();
+#else
+#ifdef DCU_THREAD_SAFE
+		memory_space = create_mspace(0, 1);
+#else
+		memory_space = create_mspace(0, 0);
+#endif //DCU_THREAD_SAFE
+#endif //DCU_PASSTHROUGH
+
+#ifdef DCU_THREAD_SAFE
+		metadata_space = create_mspace(0, 1);
+#else
+		metadata_space = create_mspace(0, 0);
+#endif //DCU_THREAD_SAFE
+
+		if (pthread_key_create(&DCU_magazine_key, DCU_flushMagazines) != 0)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to create the magazine key\n");
+			_exit(1);
+		}
+
+#ifdef DCU_ASYNC_TRACKING
+		if ((pthread_key_create(&DCU_ring_key, DCU_releaseThreadRing) != 0) ||
+			(pthread_atfork(0, 0, DCU_forkChild) != 0))
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to create the event ring key\n");
+			_exit(1);
+		}
+#endif //DCU_ASYNC_TRACKING
+
+#ifdef DCU_THREAD_MSPACES
+		if (pthread_key_create(&DCU_thread_space_key, DCU_releaseThreadSpace) != 0)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to create the thread mspace key\n");
+			_exit(1);
+		}
+#endif //DCU_THREAD_MSPACES
+
+#ifdef DCU_MMAP_TRACKING
+		DCU_page_size = sysconf(_SC_PAGESIZE);
+#endif //DCU_MMAP_TRACKING
+		//
+		// from here on the requests of this thread go to the memory spaces, untracked
+		//
+		__atomic_store_n(&DCU_init_state, DCU_InitSpacesReady, __ATOMIC_RELEASE);
+
+		//
+		// init backtrace so it wont recursively call malloc
+		// it is still the fallback of the frame pointer unwinder
+		//
+		DCU_Pointer stack[DCU_STACK_DEFAULT_DEPTH];
+		backtrace(stack, DCU_STACK_DEFAULT_DEPTH);
+		DCU_selectUnwinder();
+		DCU_selectStackDepth();
+		DCU_selectSampleInterval();
+		DCU_selectThreadPolicies();
+		DCU_selectSiteProfile();
+
+		//
+		// Init Tracing data
+		//
+
+		DCU_stream = DCU_FALLBACK_STREAM;
+		memset(DCU_memory_stats, 0, sizeof(DCU_MemoryStats) * DCU_DYNAMIC_OPERATION_TYPES);
+		memset(&DCU_memory_stats_new, 0, sizeof(DCU_MemoryStats));
+		memset(&DCU_memory_stats_new_array, 0, sizeof(DCU_MemoryStats));
+		memset(&DCU_memory_stats_c, 0, sizeof(DCU_MemoryStats));
+
+		//
+		// Operations HashTable and Problems Linked-List, one of each per shard
+		//
+		for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+		{
+			DCU_Shard& shard = DCU_shards[i];
+#ifdef DCU_INLINE_HEADERS
+			shard.blocks = 0;
+#else
+			DCU_tableInitialize(shard.memory, DCU_TABLE_INITIAL_CAPACITY);
+#endif //DCU_INLINE_HEADERS
+			memset(shard.memory_stats, 0, sizeof(DCU_MemoryStats) * DCU_DYNAMIC_OPERATION_TYPES);
+			DCU_initializeProblems(shard.problems);
+			shard.live_blocks = 0;
+			shard.peak_blocks = 0;
+		}
+
+		DCU_initializeStacks();
+
+#ifdef DCU_LOCK_FREE_TABLE
+		//
+		// Lock-free table, pages are only touched when slots are claimed
+		//
+		DCU_lock_free_table = (DCU_LockFreeSlot*) DCU_systemMmap(0, DCU_LOCK_FREE_TABLE_SIZE * sizeof(DCU_LockFreeSlot),
+				PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (DCU_lock_free_table == MAP_FAILED)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to map the lock-free table\n");
+			_exit(1);
+		}
+		DCU_lock_free_overflow = 0;
+		DCU_lock_free_overflowed = 0;
+		DCU_lock_free_reclaim_sequence = 0;
+#endif //DCU_LOCK_FREE_TABLE
+
+		//
+		// Merged Problems Linked-List
+		//
+		DCU_initializeProblems(DCU_problems);
+
+		//
+		// Open Log File
+		//
+		DCU_stream = fopen(DCU_OUTPUT_FILE, "w");
+		if (!DCU_stream)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp: Unable to open %s: %m\n", DCU_OUTPUT_FILE);
+			DCU_stream = DCU_FALLBACK_STREAM;
+		}
+		else
+		{
+			int flags = fcntl(fileno(DCU_stream), F_GETFD, 0);
+			if (flags >= 0)
+			{
+				flags |= FD_CLOEXEC;
+				fcntl(fileno(DCU_stream), F_SETFD, flags);
+			}
+
+			setvbuf(DCU_stream, stream_trace_buffer, _IOFBF, DCU_STREAM_BUFFER_SIZE);
+		}
+
+		DCU_SET_FLAG(DCU_TRACING);
+	}
+
+	__atomic_store_n(&DCU_init_state, DCU_InitDone, __ATOMIC_RELEASE);
+	DCU_initializing_thread = false;
+
+	DCU_write("DynamicCheckUp Started\n");
+	return true;
+}
+
+void DCU_shutdown()
+{
+	if (!DCU_STATE(DCU_FINISHED))
+	{
+#ifdef DCU_ASYNC_TRACKING
+		DCU_stopTracker();
+#endif //DCU_ASYNC_TRACKING
+
+		{
+			DCU_MutexScopedLock lock(DCU_mutex);
+			DCU_lockShards();
+			DCU_CLEAR_FLAG(DCU_TRACING);
+
+			DCU_analyzeMemory();
+			DCU_reportMemoryStatus();
+
+			if (DCU_site_profile_mode == DCU_SiteProfileRecord)
+			{
+				DCU_writeSiteProfile();
+			}
+
+			DCU_emptyMemory();
+
+			DCU_emptyProblems(DCU_problems);
+			DCU_unlockShards();
+		}
+
+		if (DCU_stream != DCU_FALLBACK_STREAM)
+		{
+			fclose(DCU_stream);
+			DCU_stream = DCU_FALLBACK_STREAM;
+		}
+
+		pthread_mutex_destroy(&DCU_mutex);
+		DCU_SET_FLAG(DCU_FINISHED);
+	}
+}
+
+void* DCU_requestMemory(DCU_DynamicOperationType const& type, size_t size, void* pointer, DCU_ConstPointer const caller,
+		DCU_Site const* site, size_t const alignment)
+{
+	if (!DCU_initialize())
+	{
+		return DCU_bootstrapRequest(size, pointer, alignment);
+	}
+
+	if (pointer && DCU_inBootstrapArena(pointer))
+	{
+		return DCU_leaveBootstrapArena(size, pointer, caller);
+	}
+
+	void* out = 0;
+//	DCU_write("Request Type: %d Size:\t%d", type, size);
+
+	if (!size && (type != DCU_ReallocType))
+	{
+		if (DCU_THREAD_TRACING && DCU_threadChecksProblems())
+		{
+			DCU_StackId stack = site ? DCU_createSiteStack(site) : DCU_createStackTrace(caller);
+			DCU_registerProblem(DCU_getThreadShard(), DCU_RequestZeroMemoryType, stack, DCU_NULL_STACK);
+		}
+
+		return out;
+	}
+
+	//
+	// counted blocks have room for their trailer after the user bytes
+	//
+	bool const counted = DCU_threadCountsRequests();
+	size_t const trailer_size = counted ? sizeof(DCU_CountedTrailer) : 0;
+
+	if (type == DCU_CallocType)
+	{
+#ifdef DCU_PASSTHROUGH
+		//
+		// the next allocator knows which chunks are already zeroed
+		//
+		out = DCU_blockCalloc(size + OVERWRITE_DETECTION_DATA_SIZE + trailer_size);
+#else
+		out = DCU_blockMalloc(size  + OVERWRITE_DETECTION_DATA_SIZE + trailer_size);
+		if (out)
+		{
+			memset(out, 0, size);
+		}
+#endif //DCU_PASSTHROUGH
+	}
+	else if (type == DCU_ReallocType)
+	{
+		DCU_OperationInfo* operation = 0;
+		size_t old_size = 0;
+
+		//
+		// an old block that wasn't sampled is released without the tracker
+		//
+		bool const bypass = (pointer && DCU_bypassRelease(pointer));
+		if (bypass && !DCU_countRelease(DCU_FreeType, pointer, old_size))
+		{
+			old_size = DCU_blockUsableSize(pointer);
+		}
+
+		//
+		// untraced threads still take the old block off the table
+		//
+		if (!bypass && DCU_STATE(DCU_TRACING))
+		{
+			operation = DCU_takeOperation(pointer);
+
+#ifdef DCU_ASYNC_TRACKING
+			//
+			// the old block is copied now, its request may still be on the ring of this thread,
+			// or of the thread that handed it over
+			//
+			if (!operation && pointer && DCU_THREAD_TRACING)
+			{
+				DCU_waitThreadRing();
+				operation = DCU_takeOperation(pointer);
+			}
+			if (!operation && pointer && DCU_THREAD_TRACING)
+			{
+				DCU_waitRings();
+				operation = DCU_takeOperation(pointer);
+			}
+#endif //DCU_ASYNC_TRACKING
+
+			if (operation)
+			{
+				old_size = operation->size;
+			}
+		}
+
+		//
+		// the next allocator resizes the blocks the tracker doesn't know
+		//
+		if (pointer && !operation && !bypass && DCU_unknownIsUntracked())
+		{
+			DCU_countRelease(DCU_FreeType, pointer, old_size);
+			out = DCU_realloc(pointer, size + OVERWRITE_DETECTION_DATA_SIZE + trailer_size);
+		}
+		else
+		{
+			out = DCU_blockMalloc(size + OVERWRITE_DETECTION_DATA_SIZE + trailer_size);
+			if (out)
+			{
+#ifdef ALLOCATION_VALUE
+				memset(out, ALLOCATION_VALUE, size + OVERWRITE_DETECTION_DATA_SIZE);
+#endif
+				if (operation || bypass)
+				{
+					memcpy(out, pointer, ((size > old_size) ? old_size : size));
+				}
+				else if (pointer && DCU_untracked_requests)
+				{
+					//
+					// may be an untracked block, the chunk holds at least its size
+					//
+					old_size = DCU_blockUsableSize(pointer);
+					memcpy(out, pointer, ((size > old_size) ? old_size : size));
+				}
+			}
+		}
+
+		if (operation)
+		{
+			DCU_destroyOperation(operation);
+			DCU_blockFree(pointer);
+		}
+		else if (bypass)
+		{
+			DCU_blockFree(pointer);
+		}
+	}
+	else
+	{
+		out = alignment ? DCU_blockMemalign(alignment, size + OVERWRITE_DETECTION_DATA_SIZE + trailer_size) :
+				DCU_blockMalloc(size + OVERWRITE_DETECTION_DATA_SIZE + trailer_size);
+#ifdef ALLOCATION_VALUE
+		if (out)
+		{
+			memset(out, ALLOCATION_VALUE, size + OVERWRITE_DETECTION_DATA_SIZE);
+		}
+#endif
+	}
+
+	if (out)
+	{
+
+#ifdef OVERWRITE_DETECTION_DATA
+        memcpy((char*)(out) + size, OVERWRITE_DETECTION_DATA, OVERWRITE_DETECTION_DATA_SIZE);
+#endif
+
+		bool sampled = false;
+		if (counted)
+		{
+			DCU_countOperation(type, size);
+			DCU_markCounted(out, size);
+		}
+		else if (DCU_THREAD_TRACING && DCU_admitRequest(size, sampled))
+		{
+#ifdef DCU_COMPACT_RECORDS
+			//
+			// the size doesn't fit a compact record, the block is left untracked
+			//
+			if (size > DCU_COMPACT_MAX_SIZE)
+			{
+				__atomic_store_n(&DCU_untracked_blocks, true, __ATOMIC_RELEASE);
+				__sync_fetch_and_add(&DCU_untracked_requests, 1);
+				__sync_fetch_and_add(&DCU_oversized_requests, 1);
+				return out;
+			}
+#endif //DCU_COMPACT_RECORDS
+
+			DCU_markTracked(out);
+
+			//
+			// the record and its stack are built before taking the shard lock
+			//
+			DCU_OperationInfo* operation = DCU_createOperation();
+			if (!operation)
+			{
+				__sync_fetch_and_add(&DCU_untracked_requests, 1);
+				return out;
+			}
+
+			operation->memory_address = out;
+			operation->type = type;
+			operation->sampled = sampled;
+			operation->size = size;
+
+			operation->stack = site ? DCU_createSiteStack(site) : DCU_createStackTrace(caller);
+
+#ifdef DCU_ASYNC_TRACKING
+			DCU_pushEvent(type, out, operation, 0);
+#else
+			DCU_trackRequest(operation);
+#endif //DCU_ASYNC_TRACKING
+		}
+	}
+
+//	DCU_write(" Done\n");
+
+	return out;
+}
+
+//
+// zero sized requests are reported and keep returning null, only failed requests go to the new handler
+//
+void* DCU_requestNewMemory(DCU_DynamicOperationType const& type, size_t size, DCU_ConstPointer const caller,
+		DCU_Site const* site, size_t const alignment)
+{
+	for (;;)
+	{
+		void* out = DCU_requestMemory(type, size, 0, caller, site, alignment);
+		if (out || !size)
+		{
+			return out;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+		{
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void* DCU_requestNothrowMemory(DCU_DynamicOperationType const& type, size_t size, DCU_ConstPointer const caller,
+		size_t const alignment) _GLIBCXX_USE_NOEXCEPT
+{
+	try
+	{
+		return DCU_requestNewMemory(type, size, caller, 0, alignment);
+	}
+	catch (std::bad_alloc const&)
+	{
+		return 0;
+	}
+}
+
+void DCU_releaseMemory(DCU_DynamicOperationType const& type, void* pointer, DCU_ConstPointer const caller, size_t const size)
+{
+	//
+	// arena blocks are never released
+	//
+	if (!DCU_initialize() || DCU_inBootstrapArena(pointer))
+	{
+		return;
+	}
+
+//	DCU_write("Release Type: %d Address:10%p", type, pointer);
+
+	if (pointer)
+	{
+		if (DCU_bypassRelease(pointer))
+		{
+			DCU_releaseUntracked(type, pointer);
+			return;
+		}
+
+#ifdef DCU_ASYNC_TRACKING
+		//
+		// the tracker thread checks and releases the block
+		//
+		if (DCU_THREAD_TRACING)
+		{
+			DCU_pushEvent(type, pointer, 0, size);
+			return;
+		}
+#endif //DCU_ASYNC_TRACKING
+
+		char const* abort_message = 0;
+		bool release_block = true;
+
+		if (DCU_STATE(DCU_TRACING))
+		{
+			DCU_ReleaseStatus status = DCU_trackRelease(type, pointer, caller, size, abort_message);
+
+#ifdef DCU_ASYNC_TRACKING
+			//
+			// untraced threads release their own blocks too, those were never on the table
+			//
+			if ((status == DCU_ReleaseUnallocated) && DCU_untraced_thread)
+			{
+				DCU_blockFree(pointer);
+				return;
+			}
+#endif //DCU_ASYNC_TRACKING
+
+			if ((status == DCU_ReleaseUnallocated) && DCU_unknownIsUntracked())
+			{
+				DCU_releaseUntracked(type, pointer);
+				return;
+			}
+
+			if ((status == DCU_ReleaseUnallocated) && DCU_untracked_requests)
+			{
+				//
+				// may be an untracked block, it is kept rather than reported
+				//
+				release_block = false;
+			}
+			else if (status == DCU_ReleaseUnallocated)
+			{
+				//
+				// Releasing unallocated data
+				//
+
+				DCU_registerProblem(DCU_getShard(pointer), DCU_ReleaseUnallocatedType, DCU_NULL_STACK, DCU_createStackTrace(caller));
+
+#ifdef DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
+				abort_message = "Abnormal program termination : 'Release Unallocated Memory'\n";
+#endif //DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
+
+				//
+				// the block doesn't belong to any mspace, dlmalloc would abort or corrupt itself
+				//
+				release_block = false;
+			}
+		}
+
+		//
+		// abort outside of the shard lock, DCU_shutdown needs every shard
+		//
+		if (abort_message)
+		{
+			DCU_abort(abort_message);
+			return;
+		}
+
+		if (release_block)
+		{
+			DCU_blockFree(pointer);
+		}
+	}
+	else // pointer is null
+	{
+
+#ifdef DCU_C_MEMORY_CHECK
+		if ((type == DCU_FreeType) && DCU_THREAD_TRACING && DCU_threadChecksProblems())
+		{
+			DCU_registerProblem(DCU_getThreadShard(), DCU_FreeNullType, DCU_NULL_STACK, DCU_createStackTrace(caller));
+		}
+#endif //DCU_C_MEMORY_CHECK
+
+	}
+
+//	DCU_write(" Done\n");
+}
+
+void DCU_releaseUntracked(DCU_DynamicOperationType const& type, void* pointer)
+{
+	size_t counted_size = 0;
+	DCU_countRelease(type, pointer, counted_size);
+	DCU_blockFree(pointer);
+}
+
+//
+// alignments that aren't a power of two are rounded up, as dlmalloc does
+//
+void* DCU_requestAlignedMemory(size_t alignment, size_t size, DCU_ConstPointer const caller)
+{
+	size_t power = MALLOC_ALIGNMENT;
+	while (power < alignment)
+	{
+		power <<= 1;
+	}
+
+	return DCU_requestMemory(DCU_MemalignType, size, 0, caller, 0, power);
+}
+
+//
+// tracked blocks end at the requested size, the overwrite detection data follows it
+//
+size_t DCU_usableMemory(void* pointer)
+{
+	if (!pointer)
+	{
+		return 0;
+	}
+
+	if (!DCU_initialize() || DCU_inBootstrapArena(pointer))
+	{
+		return DCU_bootstrapSize(pointer);
+	}
+
+	size_t size = 0;
+	if (DCU_STATE(DCU_TRACING))
+	{
+		DCU_Shard& shard = DCU_getShard(pointer);
+		{
+			DCU_TableScopedLock lock(shard.mutex);
+			size = DCU_findMemorySize(shard, pointer);
+		}
+
+#ifdef DCU_ASYNC_TRACKING
+		//
+		// blocks requested by the calling thread may still be on its ring
+		//
+		if (!size)
+		{
+			DCU_waitThreadRing();
+			DCU_TableScopedLock lock(shard.mutex);
+			size = DCU_findMemorySize(shard, pointer);
+		}
+#endif //DCU_ASYNC_TRACKING
+	}
+
+	//
+	// untracked blocks, counted ones end at their request size so writes can't reach the trailer
+	//
+	if (!size)
+	{
+		DCU_CountedTrailer const* trailer = DCU_getCountedTrailer(pointer);
+		size = (trailer->magic == DCU_COUNTED_MAGIC(pointer)) ? size_t(trailer->size) :
+				DCU_blockUsableSize(pointer) - OVERWRITE_DETECTION_DATA_SIZE;
+	}
+
+	return size;
+}
+
+void DCU_trackRequest(DCU_OperationInfo* operation)
+{
+	DCU_Shard& shard = DCU_getShard(operation->memory_address);
+	DCU_TableScopedLock lock(shard.mutex);
+	if (DCU_STATE(DCU_TRACING))
+	{
+		DCU_MemoryInt const weight = DCU_operationWeight(operation);
+		DCU_updateStats(shard.memory_stats[operation->type], operation->size, weight, true);
+		DCU_updateLiveBlocks(shard, true);
+		DCU_updateContext(operation->stack, operation->size, weight, true);
+		DCU_addMemory(shard, operation);
+	}
+	else
+	{
+		DCU_destroyOperation(operation);
+	}
+}
+
+//
+// realloc takes its old block without the release checks
+//
+DCU_OperationInfo* DCU_takeOperation(DCU_ConstPointer pointer)
+{
+	DCU_Shard& shard = DCU_getShard(pointer);
+	DCU_TableScopedLock lock(shard.mutex);
+	DCU_OperationInfo* operation = DCU_takeMemory(shard, pointer);
+	if (operation)
+	{
+		DCU_MemoryInt const weight = DCU_operationWeight(operation);
+		DCU_updateStats(shard.memory_stats[DCU_FreeType], operation->size, weight, false);
+		DCU_updateLiveBlocks(shard, false);
+		DCU_updateContext(operation->stack, operation->size, weight, false);
+	}
+
+	return operation;
+}
+
+DCU_ReleaseStatus DCU_trackRelease(DCU_DynamicOperationType const& type, void* pointer, DCU_ConstPointer const caller, size_t const size,
+		char const*& abort_message)
+{
+	DCU_Shard& shard = DCU_getShard(pointer);
+	DCU_OperationInfo* operation = 0;
+	abort_message = 0;
+
+	{
+		DCU_TableScopedLock lock(shard.mutex);
+		if (!DCU_STATE(DCU_TRACING))
+		{
+			return DCU_ReleaseUntraced;
+		}
+
+		operation = DCU_takeMemory(shard, pointer);
+		if (operation)
+		{
+			DCU_MemoryInt const weight = DCU_operationWeight(operation);
+			DCU_updateStats(shard.memory_stats[(type == DCU_ReallocType) ? DCU_FreeType : type], operation->size, weight, false);
+			DCU_updateLiveBlocks(shard, false);
+			DCU_updateContext(operation->stack, operation->size, weight, false);
+		}
+	}
+
+	if (!operation)
+	{
+		return DCU_ReleaseUnallocated;
+	}
+
+	//
+	// the operation is no longer reachable from the table, problems lock the shard again
+	// realloc releases its old block without checks
+	//
+	if (type != DCU_ReallocType)
+	{
+		DCU_StackId stack = DCU_NULL_STACK;
+
+#ifdef OVERWRITE_DETECTION_DATA
+		if (memcmp((char*)(pointer) + operation->size, OVERWRITE_DETECTION_DATA, OVERWRITE_DETECTION_DATA_SIZE))
+		{
+			if (caller)
+			{
+				stack = DCU_createStackTrace(caller);
+			}
+
+			DCU_registerProblem(shard, DCU_MemoryOverWriteType, operation->stack, stack);
+
+#ifdef DCU_ABORT_ON_MEMORY_OVERWRITE
+			abort_message = "Abnormal program termination : 'Memory Overwrite Detected'\n";
+#endif //DDCU_ABORT_ON_MEMORY_OVERWRITE
+		}
+#endif
+
+#ifdef DEALLOCATION_VALUE
+		memset(pointer, DEALLOCATION_VALUE, operation->size + OVERWRITE_DETECTION_DATA_SIZE);
+#endif //DEALLOCATION_VALUE
+
+		//
+		// Check for mismatch operations
+		//
+		bool mismatched_release = true;
+		if (type == DCU_FreeType)
+		{
+			mismatched_release = ! ((operation->type == DCU_MallocType) || (operation->type == DCU_CallocType) || (operation->type == DCU_ReallocType) ||
+					(operation->type == DCU_MemalignType));
+		}
+		else if (type == DCU_DeleteType)
+		{
+			mismatched_release = (operation->type != DCU_NewType);
+		}
+		else if (type == DCU_DeleteArrayType)
+		{
+			mismatched_release = (operation->type != DCU_NewArrayType);
+		}
+		else if (type == DCU_DeleteAlignedType)
+		{
+			mismatched_release = (operation->type != DCU_NewAlignedType);
+		}
+		else if (type == DCU_DeleteArrayAlignedType)
+		{
+			mismatched_release = (operation->type != DCU_NewArrayAlignedType);
+		}
+
+		if (mismatched_release)
+		{
+			if (caller && (stack == DCU_NULL_STACK))
+			{
+				stack = DCU_createStackTrace(caller);
+			}
+
+			DCU_registerProblem(shard, DCU_MismatchOperationType, operation->stack, stack);
+		}
+		else if (size && (size != operation->size))
+		{
+			//
+			// the compiler passes the size of the deleted type, a different one means delete through the wrong type
+			//
+			if (caller && (stack == DCU_NULL_STACK))
+			{
+				stack = DCU_createStackTrace(caller);
+			}
+
+			DCU_registerProblem(shard, DCU_ReleaseSizeMismatchType, operation->stack, stack);
+		}
+	}
+
+	DCU_destroyOperation(operation);
+	return DCU_ReleaseTracked;
+}
+
+void DCU_analyzeMemory()
+{
+	DCU_mergeShards();
+
+	//
+	// Memory Stats
+	//
+	for (unsigned int i = 0; i != DCU_DYNAMIC_OPERATION_TYPES; ++i)
+	{
+		switch (i)
+		{
+			case DCU_MallocType:
+			case DCU_ReallocType:
+			case DCU_CallocType:
+			case DCU_MemalignType:
+			{
+				DCU_memory_stats_c.count += DCU_memory_stats[i].count;
+				DCU_memory_stats_c.total_memory += DCU_memory_stats[i].total_memory;
+			}
+				break;
+			case DCU_FreeType:
+			{
+				DCU_memory_stats_c.count -= DCU_memory_stats[i].count;
+				DCU_memory_stats_c.total_memory -= DCU_memory_stats[i].total_memory;
+			}
+				break;
+			case DCU_NewType:
+			case DCU_NewAlignedType:
+			{
+				DCU_memory_stats_new.count += DCU_memory_stats[i].count;
+				DCU_memory_stats_new.total_memory += DCU_memory_stats[i].total_memory;
+			}
+				break;
+			case DCU_DeleteType:
+			case DCU_DeleteAlignedType:
+			{
+				DCU_memory_stats_new.count -= DCU_memory_stats[i].count;
+				DCU_memory_stats_new.total_memory -= DCU_memory_stats[i].total_memory;
+			}
+				break;
+			case DCU_NewArrayType:
+			case DCU_NewArrayAlignedType:
+			{
+				DCU_memory_stats_new_array.count += DCU_memory_stats[i].count;
+				DCU_memory_stats_new_array.total_memory += DCU_memory_stats[i].total_memory;
+			}
+				break;
+			case DCU_DeleteArrayType:
+			case DCU_DeleteArrayAlignedType:
+			{
+				DCU_memory_stats_new_array.count -= DCU_memory_stats[i].count;
+				DCU_memory_stats_new_array.total_memory -= DCU_memory_stats[i].total_memory;
+			}
+				break;
+			default:
+				break;
+		}
+	}
+
+	//
+	// Detect Memory Leaks
+	//
+#ifdef DCU_INLINE_HEADERS
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		for (DCU_InlineHeader* iterator = DCU_shards[i].blocks; iterator; iterator = iterator->next)
+		{
+			DCU_OperationInfo operation;
+			DCU_unpackHeader(iterator, &operation);
+			DCU_registerLeak(&operation);
+		}
+	}
+#else
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		DCU_tableVisit(DCU_shards[i].memory, DCU_registerLeak);
+	}
+#endif //DCU_INLINE_HEADERS
+
+#ifdef DCU_LOCK_FREE_TABLE
+	for (HastIterator slot = 0; slot != DCU_LOCK_FREE_TABLE_SIZE; ++slot)
+	{
+		DCU_OperationInfo* operation = __atomic_load_n(&DCU_lock_free_table[slot].value, __ATOMIC_ACQUIRE);
+		if (operation)
+		{
+			DCU_registerLeak(operation);
+		}
+	}
+#endif //DCU_LOCK_FREE_TABLE
+
+#ifdef DCU_MMAP_TRACKING
+	DCU_registerMappingLeaks();
+#endif //DCU_MMAP_TRACKING
+}
+
+void DCU_mergeShards()
+{
+	memset(DCU_memory_stats, 0, sizeof(DCU_MemoryStats) * DCU_DYNAMIC_OPERATION_TYPES);
+
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		DCU_Shard& shard = DCU_shards[i];
+
+		//
+		// Memory Stats
+		//
+		for (unsigned int type = 0; type != DCU_DYNAMIC_OPERATION_TYPES; ++type)
+		{
+			DCU_memory_stats[type].count += shard.memory_stats[type].count;
+			DCU_memory_stats[type].total_memory += shard.memory_stats[type].total_memory;
+
+			if (shard.memory_stats[type].max_value > DCU_memory_stats[type].max_value)
+			{
+				DCU_memory_stats[type].max_value = shard.memory_stats[type].max_value;
+			}
+		}
+
+		//
+		// Problems, the same problem may have been found on several shards
+		//
+		DCU_ProblemInfo* element = DCU_takeProblems(shard.problems);
+		while (element)
+		{
+			DCU_ProblemInfo* next = element->next;
+
+			DCU_ProblemInfo* problem = DCU_findProblem(DCU_problems, element->type, element->allocation_stack, element->deallocation_stack);
+			if (problem)
+			{
+				problem->count += element->count;
+				problem->total_memory += element->total_memory;
+				DCU_destroyProblem(element);
+			}
+			else
+			{
+				DCU_addProblem(DCU_problems, element);
+			}
+
+			element = next;
+		}
+	}
+}
+
+void DCU_reportMemoryStatus()
+{
+	DCU_write("DynamicCheckUp Memory Report\n");
+	DCU_write("----------------------------------------------------------------\n");
+	DCU_write("%15s %15s %15s %15s\n", "->", "operations", "total mem", "max value");
+
+	for (unsigned int i = 0; i != DCU_DYNAMIC_OPERATION_TYPES; ++i)
+	{
+#ifndef DCU_C_MEMORY_CHECK
+		if (i < (unsigned int)(DCU_NewType))
+		{
+			continue;
+		}
+#endif //DCU_C_MEMORY_CHECK
+
+		DCU_write("%15s %15lu %15lu %15lu\n",
+				DCU_OperationTypeNames[i],
+				DCU_unweight(DCU_memory_stats[i].count), DCU_memory_stats[i].total_memory, DCU_memory_stats[i].max_value);
+	}
+
+#ifdef DCU_MMAP_TRACKING
+	for (unsigned int i = 0; i != DCU_MAPPING_OPERATION_TYPES; ++i)
+	{
+		DCU_write("%15s %15d %15d %15d\n",
+				DCU_MappingOperationNames[i],
+				DCU_mapping_stats[i].count, DCU_mapping_stats[i].total_memory, DCU_mapping_stats[i].max_value);
+	}
+#endif //DCU_MMAP_TRACKING
+
+#ifdef DCU_LOCK_FREE_TABLE
+	if (DCU_lock_free_overflowed)
+	{
+		DCU_write("\n%15s %15lu\n", "Table Overflow", DCU_lock_free_overflowed);
+	}
+#endif //DCU_LOCK_FREE_TABLE
+
+#ifdef DCU_ASYNC_TRACKING
+	if (DCU_ring_overflows)
+	{
+		DCU_write("\n%15s %15lu\n", "Ring Overflow", DCU_ring_overflows);
+	}
+#endif //DCU_ASYNC_TRACKING
+
+	if (DCU_untracked_blocks)
+	{
+		DCU_write("\n%15s %15s\n", "Policy", DCU_TrackingPolicyNames[DCU_default_policy]);
+		DCU_write("%15s %15lu\n", "Sample Interval", DCU_sample_interval);
+
+		DCU_write("\nCounted Operations\n");
+		DCU_write("----------------------------------------------------------------\n");
+		for (unsigned int i = 0; i != DCU_DYNAMIC_OPERATION_TYPES; ++i)
+		{
+#ifndef DCU_C_MEMORY_CHECK
+			if (i < (unsigned int)(DCU_NewType))
+			{
+				continue;
+			}
+#endif //DCU_C_MEMORY_CHECK
+
+			DCU_write("%15s %15lu %15lu %15lu\n",
+					DCU_OperationTypeNames[i],
+					DCU_unweight(DCU_counted_stats[i].count), DCU_counted_stats[i].total_memory, DCU_counted_stats[i].max_value);
+		}
+	}
+
+	if (DCU_site_profile_mode != DCU_SiteProfileOff)
+	{
+		DCU_write("\n%15s %15s\n", "Site Profile", DCU_SiteProfileModeNames[DCU_site_profile_mode]);
+		if (DCU_site_profile_mode == DCU_SiteProfileReplay)
+		{
+			DCU_write("%15s %15u\n", "Profiled Sites", DCU_site_profile_count);
+		}
+	}
+
+	if (DCU_untracked_requests || DCU_lost_problems)
+	{
+		DCU_write("\n%15s %15lu\n", "Untracked", DCU_untracked_requests);
+		DCU_write("%15s %15lu\n", "Lost Problems", DCU_lost_problems);
+	}
+
+	if (DCU_unwinder != DCU_BacktraceUnwinder)
+	{
+		DCU_write("\n%15s %15s\n", "Unwinder", DCU_UnwinderTypeNames[DCU_unwinder]);
+		DCU_write("%15s %15lu\n", "Unwind Fallback", DCU_unwind_fallbacks);
+	}
+
+	DCU_write("\nDynamic Memory Balance\n");
+	DCU_write("----------------------------------------------------------------\n");
+#ifdef DCU_C_MEMORY_CHECK
+	DCU_write("%15s %15lu %15lu\n", "C Memory", DCU_unweight(DCU_memory_stats_c.count), DCU_memory_stats_c.total_memory);
+#endif //DCU_C_MEMORY_CHECK
+	DCU_write("%15s %15lu %15lu\n", "New Del", DCU_unweight(DCU_memory_stats_new.count), DCU_memory_stats_new.total_memory);
+	DCU_write("%15s %15lu %15lu\n", "New Del[]", DCU_unweight(DCU_memory_stats_new_array.count), DCU_memory_stats_new_array.total_memory);
+#ifdef DCU_MMAP_TRACKING
+	DCU_write("%15s %15lu %15lu\n", "Mapped", DCU_mappings_count, DCU_mapped_bytes);
+
+	//
+	// heap and mapped memory still held
+	//
+	DCU_MemoryStats balance = DCU_memory_stats_new;
+	balance.count += DCU_memory_stats_new_array.count + DCU_mappings_count * DCU_WEIGHT_ONE;
+	balance.total_memory += DCU_memory_stats_new_array.total_memory + DCU_mapped_bytes;
+#ifdef DCU_C_MEMORY_CHECK
+	balance.count += DCU_memory_stats_c.count;
+	balance.total_memory += DCU_memory_stats_c.total_memory;
+#endif //DCU_C_MEMORY_CHECK
+	DCU_write("%15s %15lu %15lu\n", "Total", DCU_unweight(balance.count), balance.total_memory);
+#endif //DCU_MMAP_TRACKING
+
+	//
+	// Footprints
+	//
+#ifndef DCU_PASSTHROUGH
+	DCU_MemoryInt user_footprint = mspace_footprint(memory_space);
+#endif //DCU_PASSTHROUGH
+#ifdef DCU_THREAD_MSPACES
+	{
+		DCU_MutexScopedLock lock(DCU_thread_spaces_mutex);
+		for (unsigned int i = 0; i != DCU_thread_spaces_count; ++i)
+		{
+			user_footprint += mspace_footprint(DCU_thread_spaces[i]);
+		}
+	}
+#endif //DCU_THREAD_MSPACES
+
+	//
+	// reserved but untouched table pages don't count
+	//
+	DCU_MemoryInt metadata_footprint = mspace_footprint(metadata_space);
+#ifndef DCU_INLINE_HEADERS
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		metadata_footprint += DCU_storageCommitted(DCU_shards[i].memory.current) + DCU_storageCommitted(DCU_shards[i].memory.old);
+	}
+#endif //DCU_INLINE_HEADERS
+#ifdef DCU_LOCK_FREE_TABLE
+	metadata_footprint += DCU_committedBytes(DCU_lock_free_table, DCU_LOCK_FREE_TABLE_SIZE * sizeof(DCU_LockFreeSlot));
+#endif //DCU_LOCK_FREE_TABLE
+
+	//
+	// shards don't peak at the same time, their sum is an upper bound of the live blocks
+	//
+	DCU_MemoryInt peak_blocks = 0;
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		peak_blocks += DCU_shards[i].peak_blocks;
+	}
+
+#ifdef DCU_INLINE_HEADERS
+	//
+	// the headers are requested from the user mspaces but they are tracker bytes,
+	// the mspaces only hold the headers of the live blocks now
+	//
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		DCU_MemoryInt const live_headers = DCU_shards[i].live_blocks * DCU_BLOCK_HEADER_SIZE;
+		user_footprint -= (live_headers < user_footprint) ? live_headers : user_footprint;
+	}
+	metadata_footprint += peak_blocks * DCU_BLOCK_HEADER_SIZE;
+#endif //DCU_INLINE_HEADERS
+
+	DCU_write("\nFootprint\n");
+	DCU_write("----------------------------------------------------------------\n");
+#ifdef DCU_PASSTHROUGH
+	DCU_write("%15s %15s\n", "User Blocks", "next allocator");
+#else
+	DCU_write("%15s %15lu\n", "User Blocks", user_footprint);
+#endif //DCU_PASSTHROUGH
+	DCU_write("%15s %15lu\n", "Tracker", metadata_footprint);
+	DCU_write("%15s %15lu\n", "Peak Blocks", peak_blocks);
+	if (peak_blocks)
+	{
+		DCU_write("%15s %15lu\n", "Tracker/Block", metadata_footprint / peak_blocks);
+	}
+#ifdef DCU_COMPACT_RECORDS
+	if (DCU_oversized_requests)
+	{
+		DCU_write("%15s %15lu\n", "Oversized", DCU_oversized_requests);
+	}
+#endif //DCU_COMPACT_RECORDS
+
+	//
+	// Calling context, subtrees below DCU_CONTEXT_REPORT_PERCENT of the requested memory are
+	// only shown when they still hold memory
+	//
+	DCU_ContextRollup const& context = DCU_rollupContext(&DCU_context_root);
+	DCU_write("\nCalling Context\n");
+	DCU_write("----------------------------------------------------------------\n");
+	DCU_write("%15s %15s %15s %15s  %s\n", "live count", "live mem", "count", "total mem", "frame");
+	DCU_reportContext(&DCU_context_root, 0, (context.total_memory / 100) * DCU_CONTEXT_REPORT_PERCENT);
+
+	DCU_write("\nProblems\n");
+	DCU_write("----------------------------------------------------------------\n");
+
+	DCU_ProblemInfo* iterator = DCU_problems.list;
+	while (iterator)
+	{
+		bool needs_allocation_stack = false;
+		bool needs_deallocation_stack = false;
+
+		DCU_write("{\n");
+		DCU_write("[%d] %s\n", iterator->type, DCU_ProblemTypenames[ iterator->type ]);
+		DCU_write("Count: %lu\n", DCU_unweight(iterator->count));
+
+		if ((iterator->type == DCU_LeakType) || (iterator->type == DCU_MappingLeakType))
+		{
+			DCU_write("Total Memory Lost: %d \n", iterator->total_memory);
+			needs_allocation_stack = true;
+		}
+
+		if ((iterator->type == DCU_RequestZeroMemoryType) ||
+			(iterator->type == DCU_MismatchOperationType) ||
+			(iterator->type == DCU_MemoryOverWriteType) ||
+			(iterator->type == DCU_ReleaseSizeMismatchType) ||
+			(iterator->type == DCU_PartialUnmapType))
+		{
+			needs_allocation_stack = true;
+		}
+
+		if ((iterator->type == DCU_FreeNullType) ||
+			(iterator->type == DCU_MismatchOperationType) ||
+			(iterator->type == DCU_ReleaseUnallocatedType) ||
+			(iterator->type == DCU_MemoryOverWriteType) ||
+			(iterator->type == DCU_ReleaseSizeMismatchType) ||
+			(iterator->type == DCU_PartialUnmapType))
+		{
+			needs_deallocation_stack = true;
+		}
+
+		if (needs_allocation_stack && DCU_getStack(iterator->allocation_stack).site)
+		{
+			DCU_Site const* site = (DCU_Site const*) DCU_getStack(iterator->allocation_stack).frames[0];
+			DCU_write("Allocation Site: %s:%d %s\n", site->file, site->line, site->function);
+		}
+		else if (needs_allocation_stack)
+		{
+			DCU_write("Allocation Stack: ");
+			DCU_StackEntry const& stack = DCU_getStack(iterator->allocation_stack);
+			for (unsigned int frame = 0; frame != stack.depth; ++frame)
+			{
+				DCU_write("%p ", stack.frames[frame]);
+			}
+			DCU_write("\n");
+		}
+
+		if (needs_deallocation_stack)
+		{
+			DCU_write("Deallocation Stack: ");
+			DCU_StackEntry const& stack = DCU_getStack(iterator->deallocation_stack);
+			for (unsigned int frame = 0; frame != stack.depth; ++frame)
+			{
+				DCU_write("%p ", stack.frames[frame]);
+			}
+			DCU_write("\n");
+		}
+
+		DCU_write("}\n");
+		iterator = iterator->next;
+	}
+}
+
+
+void DCU_abort(char const* message, ...)
+{
+	va_list argp;
+	va_start(argp, message);
+
+#ifdef DCU_ECHO
+if (DCU_stream != DCU_FALLBACK_STREAM)
+{
+	vfprintf(DCU_FALLBACK_STREAM, message, argp);
+}
+#endif //DDCU_ECHO
+
+	vfprintf(DCU_stream, message, argp);
+	va_end(argp);
+
+	DCU_shutdown();
+
+	kill(getpid(), SIGKILL);
+	// just in case someone catches kill
+	_exit(-1);
+}
+
+void DCU_write(char const* message, ...)
+{
+	va_list argp;
+	va_start(argp, message);
+
+#ifdef DCU_ECHO
+	if (DCU_stream != DCU_FALLBACK_STREAM)
+	{
+		vfprintf(DCU_FALLBACK_STREAM, message, argp);
+	}
+#endif //DDCU_ECHO
+
+	vfprintf(DCU_stream, message, argp);
+	va_end(argp);
+}
+
+
+DCU_OperationInfo* DCU_createOperation()
+{
+	DCU_OperationInfo* element = (DCU_OperationInfo*) DCU_slabAllocate(DCU_operation_slabs, DCU_operation_cache);
+	if (element)
+	{
+		memset(element, 0,sizeof(DCU_OperationInfo) );
+	}
+	return element;
+}
+
+DCU_ProblemInfo* DCU_createProblem()
+{
+	DCU_ProblemInfo* element = (DCU_ProblemInfo*) DCU_slabAllocate(DCU_problem_slabs, DCU_problem_cache);
+	if (element)
+	{
+		memset(element, 0,sizeof(DCU_ProblemInfo) );
+	}
+	return element;
+}
+
+void DCU_destroyOperation(DCU_OperationInfo* element)
+{
+	DCU_slabRelease(DCU_operation_slabs, DCU_operation_cache, element);
+}
+
+void DCU_destroyProblem(DCU_ProblemInfo* element)
+{
+	DCU_slabRelease(DCU_problem_slabs, DCU_problem_cache, element);
+}
+
+//
+// Slab allocator management
+//
+inline DCU_Pointer DCU_slabAllocate(DCU_SlabAllocator& allocator, DCU_MagazineCache& cache)
+{
+	if (!cache.loaded || !cache.loaded->count)
+	{
+		if (cache.previous && cache.previous->count)
+		{
+			DCU_Magazine* swap = cache.loaded;
+			cache.loaded = cache.previous;
+			cache.previous = swap;
+		}
+		else
+		{
+			//
+			// previous goes back to the depot, loaded is kept as the new previous
+			//
+			if (cache.previous)
+			{
+				DCU_exchangeMagazine(allocator, cache.previous, false);
+			}
+			else if (!DCU_magazines_registered)
+			{
+				DCU_magazines_registered = true;
+				pthread_setspecific(DCU_magazine_key, &DCU_magazines_registered);
+			}
+
+			cache.previous = cache.loaded;
+			cache.loaded = DCU_exchangeMagazine(allocator, 0, true);
+			if (!cache.loaded)
+			{
+				return DCU_slabTake(allocator);
+			}
+		}
+	}
+
+	return cache.loaded->records[--cache.loaded->count];
+}
+
+inline void DCU_slabRelease(DCU_SlabAllocator& allocator, DCU_MagazineCache& cache, DCU_Pointer record)
+{
+	if (!cache.loaded || (cache.loaded->count == DCU_MAGAZINE_SIZE))
+	{
+		if (cache.previous && (cache.previous->count != DCU_MAGAZINE_SIZE))
+		{
+			DCU_Magazine* swap = cache.loaded;
+			cache.loaded = cache.previous;
+			cache.previous = swap;
+		}
+		else
+		{
+			if (cache.previous)
+			{
+				DCU_exchangeMagazine(allocator, cache.previous, false);
+			}
+			else if (!DCU_magazines_registered)
+			{
+				DCU_magazines_registered = true;
+				pthread_setspecific(DCU_magazine_key, &DCU_magazines_registered);
+			}
+
+			cache.previous = cache.loaded;
+			cache.loaded = DCU_exchangeMagazine(allocator, 0, false);
+			if (!cache.loaded)
+			{
+				DCU_slabPut(allocator, record);
+				return;
+			}
+		}
+	}
+
+	cache.loaded->records[cache.loaded->count++] = record;
+}
+
+/*
+ * Returns magazine to the depot (when not null) and hands out a full magazine when want_full is set,
+ * an empty one otherwise. Full magazines are refilled from the slabs when the depot has none.
+ * Returns null when no magazine (or no record for a full one) can be allocated.
+ */
+DCU_Magazine* DCU_exchangeMagazine(DCU_SlabAllocator& allocator, DCU_Magazine* magazine, bool const want_full)
+{
+	DCU_MutexScopedLock lock(allocator.mutex);
+
+	if (magazine)
+	{
+		DCU_depositMagazine(allocator, magazine);
+	}
+
+	DCU_Magazine* out = 0;
+	if (want_full && allocator.full)
+	{
+		out = allocator.full;
+		allocator.full = out->next;
+		return out;
+	}
+
+	if (allocator.empty)
+	{
+		out = allocator.empty;
+		allocator.empty = out->next;
+	}
+	else
+	{
+		out = (DCU_Magazine*) DCU_metadataMalloc(sizeof(DCU_Magazine));
+		if (!out)
+		{
+			return 0;
+		}
+		out->count = 0;
+	}
+
+	if (want_full)
+	{
+		while (out->count != DCU_MAGAZINE_SIZE)
+		{
+			DCU_Pointer record = DCU_carveRecord(allocator);
+			if (!record)
+			{
+				break;
+			}
+
+			out->records[out->count++] = record;
+		}
+
+		if (!out->count)
+		{
+			DCU_depositMagazine(allocator, out);
+			return 0;
+		}
+	}
+
+	out->next = 0;
+	return out;
+}
+
+//
+// shared slab path, used when no magazine is available
+//
+DCU_Pointer DCU_slabTake(DCU_SlabAllocator& allocator)
+{
+	DCU_MutexScopedLock lock(allocator.mutex);
+	DCU_Pointer record = DCU_carveRecord(allocator);
+	if (!record)
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to allocate a tracker record\n");
+		_exit(1);
+	}
+
+	return record;
+}
+
+void DCU_slabPut(DCU_SlabAllocator& allocator, DCU_Pointer record)
+{
+	DCU_MutexScopedLock lock(allocator.mutex);
+	*(DCU_Pointer*) record = allocator.loose;
+	allocator.loose = record;
+}
+
+//
+// allocator must be locked, loose records are handed out before new ones are carved
+//
+DCU_Pointer DCU_carveRecord(DCU_SlabAllocator& allocator)
+{
+	DCU_Pointer record = allocator.loose;
+	if (record)
+	{
+		allocator.loose = *(DCU_Pointer*) record;
+		return record;
+	}
+
+	if (allocator.slab == allocator.slab_end)
+	{
+		char* slab = (char*) DCU_metadataMalloc(DCU_SLAB_SIZE);
+		if (!slab)
+		{
+			return 0;
+		}
+
+		allocator.slab = slab;
+		allocator.slab_end = slab + (DCU_SLAB_SIZE / allocator.record_size) * allocator.record_size;
+	}
+
+	record = allocator.slab;
+	allocator.slab += allocator.record_size;
+	return record;
+}
+
+//
+// allocator must be locked
+//
+inline void DCU_depositMagazine(DCU_SlabAllocator& allocator, DCU_Magazine* magazine)
+{
+	DCU_Magazine** depot = (magazine->count) ? &allocator.full : &allocator.empty;
+	magazine->next = *depot;
+	*depot = magazine;
+}
+
+void DCU_flushMagazines(void*)
+{
+	DCU_MagazineCache* caches[] = { &DCU_operation_cache, &DCU_problem_cache };
+	DCU_SlabAllocator* allocators[] = { &DCU_operation_slabs, &DCU_problem_slabs };
+
+	for (unsigned int i = 0; i != 2; ++i)
+	{
+		DCU_MagazineCache& cache = *caches[i];
+		DCU_MutexScopedLock lock(allocators[i]->mutex);
+
+		if (cache.loaded)
+		{
+			DCU_depositMagazine(*allocators[i], cache.loaded);
+		}
+
+		if (cache.previous)
+		{
+			DCU_depositMagazine(*allocators[i], cache.previous);
+		}
+
+		//
+		// records released later by this thread start new magazines
+		//
+		cache.loaded = 0;
+		cache.previous = 0;
+	}
+
+	DCU_magazines_registered = false;
+}
+
+
+//
+// DCU_OperationTable management
+//
+void DCU_tableInitialize(DCU_OperationTable& table, HastIterator const capacity)
+{
+	if (!DCU_storageAllocate(table.current, capacity))
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to allocate the operation table\n");
+		_exit(1);
+	}
+
+	table.old.control = 0;
+	table.old.slots = 0;
+	table.old.capacity = 0;
+	table.migrated = 0;
+	table.used = 0;
+	table.size = 0;
+}
+
+void DCU_tableDestroy(DCU_OperationTable& table)
+{
+#ifndef DCU_COMPACT_RECORDS
+	DCU_tableVisit(table, DCU_destroyOperation);
+#endif //DCU_COMPACT_RECORDS
+
+	DCU_storageRelease(table.current);
+	if (table.old.control)
+	{
+		DCU_storageRelease(table.old);
+	}
+
+	table.size = 0;
+}
+
+void DCU_tableInsert(DCU_OperationTable& table, DCU_OperationInfo* element)
+{
+	DCU_tableMigrate(table, DCU_TABLE_MIGRATION_STEP);
+
+	//
+	// a migration is over before the current storage is 7/8 used, see DCU_tableGrow
+	//
+	if (!table.old.control && ((table.used + 1) > (table.current.capacity - table.current.capacity / 8)))
+	{
+		DCU_tableGrow(table);
+	}
+
+	DCU_TableSlot slot;
+	DCU_packSlot(slot, element);
+
+	bool used_empty = false;
+	DCU_storageInsert(table.current, slot, DCU_HASH_FUNCTION(element->memory_address), used_empty);
+	table.used += used_empty ? 1 : 0;
+	table.size += 1;
+}
+
+DCU_OperationInfo* DCU_tableTake(DCU_OperationTable& table, DCU_ConstPointer memory_address)
+{
+	DCU_tableMigrate(table, DCU_TABLE_MIGRATION_STEP);
+
+	HastIterator hash = DCU_HASH_FUNCTION(memory_address);
+	DCU_TableStorage* storage = &table.current;
+	HastIterator index = DCU_storageFind(*storage, memory_address, hash);
+
+	if ((index == DCU_TABLE_NOT_FOUND) && table.old.control)
+	{
+		storage = &table.old;
+		index = DCU_storageFind(*storage, memory_address, hash);
+	}
+
+	if (index == DCU_TABLE_NOT_FOUND)
+	{
+		return 0;
+	}
+
+#ifdef DCU_COMPACT_RECORDS
+	DCU_OperationInfo* element = DCU_createOperation();
+	DCU_unpackSlot(storage->slots[index], element);
+#else
+	DCU_OperationInfo* element = storage->slots[index];
+#endif //DCU_COMPACT_RECORDS
+	DCU_storageErase(*storage, index);
+	table.size -= 1;
+	return element;
+}
+
+size_t DCU_tableFindSize(DCU_OperationTable& table, DCU_ConstPointer memory_address)
+{
+	HastIterator hash = DCU_HASH_FUNCTION(memory_address);
+	DCU_TableStorage* storage = &table.current;
+	HastIterator index = DCU_storageFind(*storage, memory_address, hash);
+
+	if ((index == DCU_TABLE_NOT_FOUND) && table.old.control)
+	{
+		storage = &table.old;
+		index = DCU_storageFind(*storage, memory_address, hash);
+	}
+
+	if (index == DCU_TABLE_NOT_FOUND)
+	{
+		return 0;
+	}
+
+#ifdef DCU_COMPACT_RECORDS
+	DCU_OperationInfo element;
+	DCU_unpackSlot(storage->slots[index], &element);
+	return element.size;
+#else
+	return storage->slots[index]->size;
+#endif //DCU_COMPACT_RECORDS
+}
+
+void DCU_tableVisit(DCU_OperationTable& table, void (*visitor)(DCU_OperationInfo*))
+{
+	DCU_TableStorage* storages[2] = { &table.current, &table.old };
+
+	for (unsigned int i = 0; i != 2; ++i)
+	{
+		DCU_TableStorage& storage = *storages[i];
+		for (HastIterator index = 0; storage.control && (index != storage.capacity); ++index)
+		{
+			if (DCU_TABLE_FULL(storage.control[index]))
+			{
+#ifdef DCU_COMPACT_RECORDS
+				DCU_OperationInfo element;
+				DCU_unpackSlot(storage.slots[index], &element);
+				visitor(&element);
+#else
+				visitor(storage.slots[index]);
+#endif //DCU_COMPACT_RECORDS
+			}
+		}
+	}
+}
+
+bool DCU_storageAllocate(DCU_TableStorage& storage, HastIterator const capacity)
+{
+	//
+	// slots and control bytes share a single mapping, slots first to keep them aligned,
+	// zeroed pages are empty slots
+	//
+	size_t const length = capacity * (sizeof(signed char) + sizeof(DCU_TableSlot));
+	char* block = (char*) DCU_systemMmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (block == MAP_FAILED)
+	{
+		return false;
+	}
+
+	storage.slots = (DCU_TableSlot*) block;
+	storage.control = (signed char*) (block + capacity * sizeof(DCU_TableSlot));
+	storage.capacity = capacity;
+	return true;
+}
+
+void DCU_storageRelease(DCU_TableStorage& storage)
+{
+	size_t const length = storage.capacity * (sizeof(signed char) + sizeof(DCU_TableSlot));
+	DCU_systemMunmap(storage.slots, length);
+
+	storage.control = 0;
+	storage.slots = 0;
+	storage.capacity = 0;
+}
+
+//
+// table storages are mapped with MAP_NORESERVE, only the pages already touched are committed
+//
+DCU_MemoryInt DCU_committedBytes(void const* address, size_t const length)
+{
+	size_t const page_size = sysconf(_SC_PAGESIZE);
+	unsigned char residency[256];
+	DCU_MemoryInt committed = 0;
+
+	char* page = (char*) address;
+	char* const end = (char*) address + length;
+	while (page < end)
+	{
+		size_t pages = (end - page + page_size - 1) / page_size;
+		if (pages > sizeof(residency))
+		{
+			pages = sizeof(residency);
+		}
+
+		if (mincore(page, pages * page_size, residency) != 0)
+		{
+			break;
+		}
+
+		for (size_t i = 0; i != pages; ++i)
+		{
+			committed += (residency[i] & 1) ? page_size : 0;
+		}
+		page += pages * page_size;
+	}
+
+	return committed;
+}
+
+DCU_MemoryInt DCU_storageCommitted(DCU_TableStorage const& storage)
+{
+	return storage.control ? DCU_committedBytes(storage.slots, storage.capacity * (sizeof(signed char) + sizeof(DCU_TableSlot))) : 0;
+}
+
+void DCU_storageInsert(DCU_TableStorage& storage, DCU_TableSlot const& element, HastIterator const hash, bool& used_empty)
+{
+	HastIterator const group_mask = storage.capacity / DCU_TABLE_GROUP_SIZE - 1;
+	HastIterator group = DCU_TABLE_GROUP(hash) & group_mask;
+
+	//
+	// triangular probing visits every group of a power of two table, the table is never full
+	//
+	for (HastIterator probe = 1; ; ++probe)
+	{
+		signed char* control = storage.control + group * DCU_TABLE_GROUP_SIZE;
+		unsigned int free_slots = DCU_groupMatchFree(control);
+
+		if (free_slots)
+		{
+			HastIterator slot = __builtin_ctz(free_slots);
+			used_empty = (control[slot] == DCU_TABLE_EMPTY);
+			control[slot] = DCU_TABLE_FINGERPRINT(hash);
+			storage.slots[group * DCU_TABLE_GROUP_SIZE + slot] = element;
+			return;
+		}
+
+		group = (group + probe) & group_mask;
+	}
+}
+
+HastIterator DCU_storageFind(DCU_TableStorage& storage, DCU_ConstPointer memory_address, HastIterator const hash)
+{
+	HastIterator const group_mask = storage.capacity / DCU_TABLE_GROUP_SIZE - 1;
+	HastIterator group = DCU_TABLE_GROUP(hash) & group_mask;
+	signed char const fingerprint = DCU_TABLE_FINGERPRINT(hash);
+
+	for (HastIterator probe = 1; probe <= (group_mask + 1); ++probe)
+	{
+		signed char const* control = storage.control + group * DCU_TABLE_GROUP_SIZE;
+
+		for (unsigned int match = DCU_groupMatch(control, fingerprint); match; match &= match - 1)
+		{
+			HastIterator index = group * DCU_TABLE_GROUP_SIZE + __builtin_ctz(match);
+			if (DCU_slotAddress(storage.slots[index]) == memory_address)
+			{
+				return index;
+			}
+		}
+
+		//
+		// an insert would have used the empty slot, the operation isn't further along
+		//
+		if (DCU_groupMatch(control, DCU_TABLE_EMPTY))
+		{
+			break;
+		}
+
+		group = (group + probe) & group_mask;
+	}
+
+	return DCU_TABLE_NOT_FOUND;
+}
+
+void DCU_storageErase(DCU_TableStorage& storage, HastIterator const index)
+{
+	//
+	// a group with an empty slot never sent a probe further, so the slot may become empty again
+	//
+	signed char* control = storage.control + (index & ~HastIterator(DCU_TABLE_GROUP_SIZE - 1));
+	storage.control[index] = DCU_groupMatch(control, DCU_TABLE_EMPTY) ? DCU_TABLE_EMPTY : DCU_TABLE_DELETED;
+}
+
+void DCU_tableGrow(DCU_OperationTable& table)
+{
+	//
+	// the old storage is at most 7/8 used and drained in capacity / DCU_TABLE_MIGRATION_STEP operations,
+	// meanwhile the new one takes at most 57/64 of the old capacity when it doubles, or 17/64 when
+	// a mostly deleted storage keeps its size, below 7/8 of its own, so growth never waits for a migration
+	//
+	// mostly deleted slots are cleaned on a table of the same size
+	//
+	HastIterator capacity = table.current.capacity;
+	if (table.size >= capacity / 4)
+	{
+		capacity *= 2;
+	}
+
+	DCU_TableStorage storage;
+	if (!DCU_storageAllocate(storage, capacity))
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to grow the operation table\n");
+		_exit(1);
+	}
+
+	table.old = table.current;
+	table.current = storage;
+	table.migrated = 0;
+	table.used = 0;
+}
+
+void DCU_tableMigrate(DCU_OperationTable& table, HastIterator steps)
+{
+	if (!table.old.control)
+	{
+		return;
+	}
+
+	DCU_TableStorage& old = table.old;
+	for (; steps && (table.migrated != old.capacity); --steps, ++table.migrated)
+	{
+		if (DCU_TABLE_FULL(old.control[table.migrated]))
+		{
+			DCU_TableSlot& slot = old.slots[table.migrated];
+			bool used_empty = false;
+			DCU_storageInsert(table.current, slot, DCU_HASH_FUNCTION(DCU_slotAddress(slot)), used_empty);
+			table.used += used_empty ? 1 : 0;
+			old.control[table.migrated] = DCU_TABLE_DELETED;
+		}
+	}
+
+	if (table.migrated == old.capacity)
+	{
+		DCU_storageRelease(old);
+		table.migrated = 0;
+	}
+}
+
+#ifdef DCU_COMPACT_RECORDS
+inline DCU_ConstPointer DCU_slotAddress(DCU_TableSlot const& slot)
+{
+	return (DCU_ConstPointer) DCU_MemoryInt((slot.address_size & DCU_COMPACT_ADDRESS_MASK) << 3);
+}
+
+inline void DCU_packSlot(DCU_TableSlot& slot, DCU_OperationInfo* element)
+{
+	//
+	// the operation only lives on the table from now on
+	//
+	DCU_RecordWord size = element->size;
+	slot.address_size = DCU_COMPACT_ADDRESS(element->memory_address) | (size << 48);
+	slot.size_type_stack = (size >> 16) | (DCU_RecordWord(element->type) << 24) | (DCU_RecordWord(element->sampled) << 28) |
+			(DCU_RecordWord(element->stack) << 32);
+	DCU_destroyOperation(element);
+}
+
+inline void DCU_unpackSlot(DCU_TableSlot const& slot, DCU_OperationInfo* element)
+{
+	element->next = 0;
+	element->memory_address = DCU_slotAddress(slot);
+	element->size = size_t((slot.address_size >> 48) | ((slot.size_type_stack & 0xFFFFFFULL) << 16));
+	element->type = DCU_DynamicOperationType((slot.size_type_stack >> 24) & 15);
+	element->sampled = ((slot.size_type_stack >> 28) & 1);
+	element->stack = DCU_StackId(slot.size_type_stack >> 32);
+}
+#else
+inline DCU_ConstPointer DCU_slotAddress(DCU_TableSlot const& slot)
+{
+	return slot->memory_address;
+}
+
+inline void DCU_packSlot(DCU_TableSlot& slot, DCU_OperationInfo* element)
+{
+	slot = element;
+}
+
+inline void DCU_unpackSlot(DCU_TableSlot const& slot, DCU_OperationInfo* element)
+{
+	*element = *slot;
+}
+#endif //DCU_COMPACT_RECORDS
+
+#ifdef __SSE2__
+inline unsigned int DCU_groupMatch(signed char const* group, signed char const value)
+{
+	__m128i control = _mm_loadu_si128((__m128i const*) group);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(value)));
+}
+
+inline unsigned int DCU_groupMatchFree(signed char const* group)
+{
+	//
+	// empty and deleted are the only control bytes without the sign bit
+	//
+	return ~_mm_movemask_epi8(_mm_loadu_si128((__m128i const*) group)) & 0xFFFF;
+}
+#else
+inline unsigned int DCU_groupMatch(signed char const* group, signed char const value)
+{
+	unsigned int match = 0;
+	for (unsigned int i = 0; i != DCU_TABLE_GROUP_SIZE; ++i)
+	{
+		match |= (group[i] == value) ? (1u << i) : 0u;
+	}
+	return match;
+}
+
+inline unsigned int DCU_groupMatchFree(signed char const* group)
+{
+	unsigned int match = 0;
+	for (unsigned int i = 0; i != DCU_TABLE_GROUP_SIZE; ++i)
+	{
+		match |= DCU_TABLE_FULL(group[i]) ? 0u : (1u << i);
+	}
+	return match;
+}
+#endif //__SSE2__
+
+//
+// Stack table management
+//
+void DCU_initializeStacks()
+{
+	for (unsigned int i = 0; i != DCU_STACK_STRIPES; ++i)
+	{
+		DCU_StackStripe& stripe = DCU_stack_stripes[i];
+		if (pthread_mutex_init(&stripe.mutex, 0) < 0)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to initialize stack mutex\n");
+			_exit(1);
+		}
+
+		memset(stripe.directory, 0, sizeof(stripe.directory));
+		stripe.count = 0;
+		stripe.arena = 0;
+		stripe.arena_left = 0;
+		stripe.index_capacity = DCU_STACK_INDEX_INITIAL_CAPACITY;
+		stripe.index = (DCU_StackId*) DCU_metadataMalloc(stripe.index_capacity * sizeof(DCU_StackId));
+		memset(stripe.index, 0, stripe.index_capacity * sizeof(DCU_StackId));
+	}
+
+	memset(&DCU_context_root, 0, sizeof(DCU_ContextNode));
+	DCU_null_stack.frames = 0;
+	DCU_null_stack.depth = 0;
+	DCU_null_stack.site = false;
+	DCU_null_stack.context = &DCU_context_root;
+}
+
+DCU_StackId DCU_internStack(DCU_ConstPointer const* stack, unsigned int const depth, bool const site)
+{
+	if (!depth)
+	{
+		return DCU_NULL_STACK;
+	}
+
+	HastIterator hash = DCU_hashStack(stack, depth);
+
+	//
+	// stored stacks never change, the thread cache is checked without any lock
+	//
+	DCU_StackId& cached = DCU_stack_cache[hash & (DCU_STACK_CACHE_SIZE - 1)];
+	if (cached)
+	{
+		DCU_StackEntry const& entry = DCU_getStack(cached);
+		if ((entry.depth == depth) && DCU_stacksMatch(stack, entry.frames, depth))
+		{
+			return cached;
+		}
+	}
+
+	unsigned int stripe_index = (unsigned int) (hash >> DCU_HASH_HALF_BITS) & (DCU_STACK_STRIPES - 1);
+	DCU_StackStripe& stripe = DCU_stack_stripes[stripe_index];
+
+	DCU_MutexScopedLock lock(stripe.mutex);
+
+	HastIterator slot = hash & (stripe.index_capacity - 1);
+	for (; stripe.index[slot]; slot = (slot + 1) & (stripe.index_capacity - 1))
+	{
+		DCU_StackEntry const& entry = DCU_getStack(stripe.index[slot]);
+		if ((entry.depth == depth) && DCU_stacksMatch(stack, entry.frames, depth))
+		{
+			cached = stripe.index[slot];
+			return cached;
+		}
+	}
+
+	unsigned int local = stripe.count;
+	unsigned int chunk = local >> DCU_STACK_CHUNK_BITS;
+	if (chunk == DCU_STACK_DIRECTORY_SIZE)
+	{
+		return DCU_NULL_STACK;
+	}
+
+	if (!stripe.directory[chunk])
+	{
+		stripe.directory[chunk] = (DCU_StackEntry*) DCU_metadataMalloc(DCU_STACK_CHUNK_SIZE * sizeof(DCU_StackEntry));
+		if (!stripe.directory[chunk])
+		{
+			return DCU_NULL_STACK;
+		}
+	}
+
+	//
+	// the rest of an arena too small for the stack is left unused
+	//
+	if (stripe.arena_left < depth)
+	{
+		stripe.arena = (DCU_ConstPointer*) DCU_metadataMalloc(DCU_STACK_ARENA_FRAMES * sizeof(DCU_ConstPointer));
+		stripe.arena_left = stripe.arena ? DCU_STACK_ARENA_FRAMES : 0;
+		if (!stripe.arena)
+		{
+			return DCU_NULL_STACK;
+		}
+	}
+
+	DCU_ConstPointer* frames = stripe.arena;
+	memcpy(frames, stack, depth * sizeof(DCU_ConstPointer));
+	stripe.arena += depth;
+	stripe.arena_left -= depth;
+
+	DCU_StackEntry& entry = stripe.directory[chunk][local & (DCU_STACK_CHUNK_SIZE - 1)];
+	entry.frames = frames;
+	entry.depth = depth;
+	entry.site = site;
+	entry.context = DCU_insertContext(frames, depth, site);
+	stripe.count += 1;
+
+	DCU_StackId id = ((local + 1) << DCU_STACK_STRIPE_BITS) | stripe_index;
+	stripe.index[slot] = id;
+
+	if ((stripe.count * 4) > (stripe.index_capacity * 3))
+	{
+		DCU_growStackIndex(stripe);
+	}
+
+	cached = id;
+	return id;
+}
+
+inline DCU_StackEntry const& DCU_getStack(DCU_StackId const id)
+{
+	if (id == DCU_NULL_STACK)
+	{
+		return DCU_null_stack;
+	}
+
+	DCU_StackStripe& stripe = DCU_stack_stripes[id & (DCU_STACK_STRIPES - 1)];
+	unsigned int local = (id >> DCU_STACK_STRIPE_BITS) - 1;
+	return stripe.directory[local >> DCU_STACK_CHUNK_BITS][local & (DCU_STACK_CHUNK_SIZE - 1)];
+}
+
+HastIterator DCU_hashStack(DCU_ConstPointer const* stack, unsigned int const depth)
+{
+	HastIterator hash = depth;
+	for (unsigned int i = 0; i != depth; ++i)
+	{
+		hash = (hash ^ HastIterator(stack[i])) * HastIterator(0x9E3779B97F4A7C15ULL);
+	}
+	return DCU_foldHash(hash);
+}
+
+void DCU_growStackIndex(DCU_StackStripe& stripe)
+{
+	unsigned int capacity = stripe.index_capacity * 2;
+	DCU_StackId* index = (DCU_StackId*) DCU_metadataMalloc(capacity * sizeof(DCU_StackId));
+	if (!index)
+	{
+		return;
+	}
+	memset(index, 0, capacity * sizeof(DCU_StackId));
+
+	for (unsigned int i = 0; i != stripe.index_capacity; ++i)
+	{
+		if (stripe.index[i])
+		{
+			DCU_StackEntry const& entry = DCU_getStack(stripe.index[i]);
+			HastIterator slot = DCU_hashStack(entry.frames, entry.depth) & (capacity - 1);
+			while (index[slot])
+			{
+				slot = (slot + 1) & (capacity - 1);
+			}
+			index[slot] = stripe.index[i];
+		}
+	}
+
+	DCU_metadataFree(stripe.index);
+	stripe.index = index;
+	stripe.index_capacity = capacity;
+}
+
+//
+// Calling-context tree management
+//
+DCU_ContextNode* DCU_insertContext(DCU_ConstPointer const* stack, unsigned int const depth, bool const site)
+{
+	DCU_MutexScopedLock lock(DCU_context_mutex);
+
+	DCU_ContextNode* node = &DCU_context_root;
+	for (unsigned int frame = depth; frame != 0; --frame)
+	{
+		node = DCU_findContextChild(node, stack[frame - 1]);
+	}
+
+	if (site && (node != &DCU_context_root))
+	{
+		node->site = true;
+	}
+
+	return node;
+}
+
+DCU_ContextNode* DCU_findContextChild(DCU_ContextNode* parent, DCU_ConstPointer frame)
+{
+	if (parent->last_child && (parent->last_child->frame == frame))
+	{
+		return parent->last_child;
+	}
+
+	DCU_ContextNode* child = parent->children;
+	while (child && (child->frame != frame))
+	{
+		child = child->next_sibling;
+	}
+
+	if (!child)
+	{
+		//
+		// without memory the stack is attributed to its deepest known caller
+		//
+		child = (DCU_ContextNode*) DCU_metadataMalloc(sizeof(DCU_ContextNode));
+		if (!child)
+		{
+			return parent;
+		}
+
+		memset(child, 0, sizeof(DCU_ContextNode));
+		child->frame = frame;
+		child->next_sibling = parent->children;
+		parent->children = child;
+	}
+
+	parent->last_child = child;
+	return child;
+}
+
+inline DCU_ContextNode* DCU_getStackContext(DCU_StackId const id)
+{
+	if (id == DCU_NULL_STACK)
+	{
+		return &DCU_context_root;
+	}
+
+	return DCU_getStack(id).context;
+}
+
+inline void DCU_updateContext(DCU_StackId const stack, size_t const size, DCU_MemoryInt const weight, bool const request)
+{
+	//
+	// operations of a site live on every shard, the node counters can't rely on a shard lock
+	//
+	DCU_ContextNode* node = DCU_getStackContext(stack);
+#ifdef DCU_THREAD_SAFE
+	if (request)
+	{
+		__sync_fetch_and_add(&node->requests, weight);
+		__sync_fetch_and_add(&node->requested_memory, DCU_weightedSize(size, weight));
+	}
+	else
+	{
+		__sync_fetch_and_add(&node->releases, weight);
+		__sync_fetch_and_add(&node->released_memory, DCU_weightedSize(size, weight));
+	}
+#else
+	if (request)
+	{
+		node->requests += weight;
+		node->requested_memory += DCU_weightedSize(size, weight);
+	}
+	else
+	{
+		node->releases += weight;
+		node->released_memory += DCU_weightedSize(size, weight);
+	}
+#endif //DCU_THREAD_SAFE
+}
+
+//
+// post-order, every node is summed once
+//
+DCU_ContextRollup const& DCU_rollupContext(DCU_ContextNode* node)
+{
+	DCU_ContextRollup& rollup = node->rollup;
+	rollup.live_count = node->requests - node->releases;
+	rollup.live_memory = node->requested_memory - node->released_memory;
+	rollup.total_count = node->requests;
+	rollup.total_memory = node->requested_memory;
+
+	for (DCU_ContextNode* child = node->children; child; child = child->next_sibling)
+	{
+		DCU_ContextRollup const& child_rollup = DCU_rollupContext(child);
+		rollup.live_count += child_rollup.live_count;
+		rollup.live_memory += child_rollup.live_memory;
+		rollup.total_count += child_rollup.total_count;
+		rollup.total_memory += child_rollup.total_memory;
+	}
+
+	return rollup;
+}
+
+void DCU_reportContext(DCU_ContextNode const* node, unsigned int const depth, DCU_MemoryInt const threshold)
+{
+	DCU_ContextRollup const& rollup = node->rollup;
+	if ((!rollup.live_memory && (rollup.total_memory < threshold)) || !rollup.total_count)
+	{
+		return;
+	}
+
+	//
+	// the root has no frame, its row holds the whole program
+	//
+	DCU_write("%15lu %15lu %15lu %15lu  %*s", DCU_unweight(rollup.live_count), rollup.live_memory,
+			DCU_unweight(rollup.total_count), rollup.total_memory, depth * 2, "");
+	if (node->site)
+	{
+		DCU_Site const* site = (DCU_Site const*) node->frame;
+		DCU_write("%s:%d %s\n", site->file, site->line, site->function);
+	}
+	else if (node->frame)
+	{
+		DCU_write("%p\n", node->frame);
+	}
+	else
+	{
+		DCU_write("all\n");
+	}
+
+	for (DCU_ContextNode const* child = node->children; child; child = child->next_sibling)
+	{
+		DCU_reportContext(child, depth + 1, threshold);
+	}
+}
+
+//
+// Shard management
+//
+inline DCU_Shard& DCU_getShard(DCU_ConstPointer memory_address)
+{
+	return DCU_shards[DCU_SHARD_INDEX(DCU_HASH_FUNCTION(memory_address))];
+}
+
+inline DCU_Shard& DCU_getThreadShard()
+{
+	return DCU_getShard((DCU_ConstPointer) pthread_self());
+}
+
+void DCU_lockShards()
+{
+#ifdef DCU_THREAD_SAFE
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+		pthread_mutex_lock(&DCU_shards[i].mutex);
+	}
+#endif //DCU_THREAD_SAFE
+}
+
+void DCU_unlockShards()
+{
+#ifdef DCU_THREAD_SAFE
+	for (unsigned int i = DCU_SHARD_COUNT; i != 0; --i)
+	{
+		pthread_mutex_unlock(&DCU_shards[i - 1].mutex);
+	}
+#endif //DCU_THREAD_SAFE
+}
+
+inline void DCU_updateStats(DCU_MemoryStats& stats, size_t size, DCU_MemoryInt const weight, bool const track_max_value)
+{
+#ifdef DCU_LOCK_FREE_TABLE
+	__sync_fetch_and_add(&stats.count, weight);
+	__sync_fetch_and_add(&stats.total_memory, DCU_weightedSize(size, weight));
+
+	if (track_max_value)
+	{
+		DCU_MemoryInt max_value = stats.max_value;
+		while ((size > max_value) && !__sync_bool_compare_and_swap(&stats.max_value, max_value, size))
+		{
+			max_value = stats.max_value;
+		}
+	}
+#else
+	stats.count += weight;
+	stats.total_memory += DCU_weightedSize(size, weight);
+
+	if (track_max_value && (size > stats.max_value))
+	{
+		stats.max_value = size;
+	}
+#endif //DCU_LOCK_FREE_TABLE
+}
+
+inline void DCU_updateLiveBlocks(DCU_Shard& shard, bool const request)
+{
+#ifdef DCU_LOCK_FREE_TABLE
+	if (!request)
+	{
+		__sync_fetch_and_sub(&shard.live_blocks, 1);
+		return;
+	}
+
+	DCU_MemoryInt live_blocks = __sync_add_and_fetch(&shard.live_blocks, 1);
+	DCU_MemoryInt peak_blocks = shard.peak_blocks;
+	while ((live_blocks > peak_blocks) && !__sync_bool_compare_and_swap(&shard.peak_blocks, peak_blocks, live_blocks))
+	{
+		peak_blocks = shard.peak_blocks;
+	}
+#else
+	if (!request)
+	{
+		shard.live_blocks--;
+	}
+	else if (++shard.live_blocks > shard.peak_blocks)
+	{
+		shard.peak_blocks = shard.live_blocks;
+	}
+#endif //DCU_LOCK_FREE_TABLE
+}
+
+#ifdef DCU_ASYNC_TRACKING
+//
+// Asynchronous tracking
+//
+void DCU_pushEvent(DCU_DynamicOperationType const type, DCU_ConstPointer memory_address, DCU_OperationInfo* operation, size_t const size)
+{
+	DCU_Event event = { memory_address, operation, type, size };
+
+	int state = __atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE);
+	if (state == DCU_TrackerStopped)
+	{
+		DCU_startTracker();
+		state = __atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE);
+	}
+
+	if (state == DCU_TrackerSynchronous)
+	{
+		DCU_applyEventNow(event);
+		return;
+	}
+
+	DCU_EventRing* ring = DCU_thread_ring ? DCU_thread_ring : DCU_acquireThreadRing();
+	if (!ring)
+	{
+		DCU_applyEventNow(event);
+		return;
+	}
+
+	DCU_MemoryInt tail = ring->tail;
+
+	if ((tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) == DCU_EVENT_RING_SIZE)
+	{
+		__sync_fetch_and_add(&DCU_ring_overflows, 1);
+
+#ifdef DCU_ASYNC_OVERFLOW_SPILL
+		DCU_applyEventNow(event);
+		return;
+#else
+		while ((tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) == DCU_EVENT_RING_SIZE)
+		{
+			if (__atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE) == DCU_TrackerSynchronous)
+			{
+				DCU_applyEventNow(event);
+				return;
+			}
+
+			sched_yield();
+		}
+#endif //DCU_ASYNC_OVERFLOW_SPILL
+	}
+
+	ring->events[tail & (DCU_EVENT_RING_SIZE - 1)] = event;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+DCU_EventRing* DCU_acquireThreadRing()
+{
+	DCU_EventRing* ring = 0;
+
+	{
+		DCU_MutexScopedLock lock(DCU_rings_mutex);
+
+		//
+		// rings of finished threads are reused once the tracker drained them
+		//
+		for (ring = DCU_rings; ring; ring = ring->next)
+		{
+			if (__atomic_load_n(&ring->released, __ATOMIC_ACQUIRE) &&
+				(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail))
+			{
+				ring->released = false;
+				break;
+			}
+		}
+
+		if (!ring)
+		{
+			ring = (DCU_EventRing*) DCU_metadataMalloc(sizeof(DCU_EventRing));
+			if (!ring)
+			{
+				//
+				// the thread applies its events itself, the next push tries again
+				//
+				return 0;
+			}
+
+			ring->released = false;
+			ring->head = 0;
+			ring->tail = 0;
+			ring->next = DCU_rings;
+			__atomic_store_n(&DCU_rings, ring, __ATOMIC_RELEASE);
+		}
+	}
+
+	DCU_thread_ring = ring;
+	pthread_setspecific(DCU_ring_key, ring);
+	return ring;
+}
+
+void DCU_releaseThreadRing(void* ring)
+{
+	//
+	// later events of the finished thread go to a new ring, a ring has a single producer
+	//
+	DCU_thread_ring = 0;
+	__atomic_store_n(&((DCU_EventRing*) ring)->released, true, __ATOMIC_RELEASE);
+}
+
+void DCU_startTracker()
+{
+	if (!__sync_bool_compare_and_swap(&DCU_tracker_state, DCU_TrackerStopped, DCU_TrackerStarting))
+	{
+		return;
+	}
+
+	DCU_untraced_thread = true;
+	int created = pthread_create(&DCU_tracker_thread, 0, DCU_trackerMain, 0);
+	DCU_untraced_thread = false;
+
+	if (created == 0)
+	{
+		__atomic_store_n(&DCU_tracker_state, DCU_TrackerRunning, __ATOMIC_RELEASE);
+	}
+	else
+	{
+		__atomic_store_n(&DCU_tracker_state, DCU_TrackerSynchronous, __ATOMIC_RELEASE);
+	}
+}
+
+void DCU_stopTracker()
+{
+	int state = __atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE);
+	while (state == DCU_TrackerStarting)
+	{
+		sched_yield();
+		state = __atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE);
+	}
+
+	if (state == DCU_TrackerRunning)
+	{
+		__atomic_store_n(&DCU_tracker_state, DCU_TrackerStopping, __ATOMIC_RELEASE);
+		//
+		// DCU_abort may shutdown from the tracker thread
+		//
+		if (!pthread_equal(pthread_self(), DCU_tracker_thread))
+		{
+			bool untraced = DCU_untraced_thread;
+			DCU_untraced_thread = true;
+			pthread_join(DCU_tracker_thread, 0);
+			DCU_untraced_thread = untraced;
+		}
+	}
+
+	//
+	// from now on events are applied by the threads that push them
+	//
+	__atomic_store_n(&DCU_tracker_state, DCU_TrackerSynchronous, __ATOMIC_RELEASE);
+
+	while (DCU_drainEvents())
+	{
+		DCU_retryPendingReleases(false);
+	}
+	DCU_retryPendingReleases(true);
+}
+
+void* DCU_trackerMain(void*)
+{
+	DCU_untraced_thread = true;
+
+	while (__atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE) != DCU_TrackerStopping)
+	{
+		bool drained = DCU_drainEvents();
+		DCU_retryPendingReleases(false);
+
+		if (!drained)
+		{
+			if (__atomic_load_n(&DCU_ring_waiters, __ATOMIC_ACQUIRE))
+			{
+				sched_yield();
+			}
+			else
+			{
+				usleep(DCU_ASYNC_IDLE_SLEEP);
+			}
+		}
+	}
+
+	return 0;
+}
+
+void DCU_waitThreadRing()
+{
+	DCU_EventRing* ring = DCU_thread_ring;
+	if (ring)
+	{
+		DCU_waitRing(ring, ring->tail);
+	}
+}
+
+//
+// returns once the tracker applied every event pushed on any ring before the call
+//
+void DCU_waitRings()
+{
+	for (DCU_EventRing* ring = __atomic_load_n(&DCU_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+	{
+		DCU_waitRing(ring, __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+	}
+}
+
+void DCU_waitRing(DCU_EventRing* ring, DCU_MemoryInt const tail)
+{
+	if (DCU_SignedMemoryInt(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) <= 0)
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&DCU_ring_waiters, 1, __ATOMIC_ACQ_REL);
+	while (DCU_SignedMemoryInt(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) > 0)
+	{
+		int const state = __atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE);
+		if ((state == DCU_TrackerStopped) || (state == DCU_TrackerSynchronous))
+		{
+			break;
+		}
+
+		sched_yield();
+	}
+	__atomic_sub_fetch(&DCU_ring_waiters, 1, __ATOMIC_ACQ_REL);
+}
+
+bool DCU_drainEvents()
+{
+	bool drained = false;
+	char const* abort_message = 0;
+
+	for (DCU_EventRing* ring = __atomic_load_n(&DCU_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+	{
+		DCU_MemoryInt head = ring->head;
+		DCU_MemoryInt tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+		if (head != tail)
+		{
+			for (; head != tail; ++head)
+			{
+				DCU_applyEvent(ring->events[head & (DCU_EVENT_RING_SIZE - 1)], abort_message);
+			}
+
+			__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+			drained = true;
+		}
+	}
+
+	//
+	// DCU_shutdown drains the rings again, the events that abort must be off them first
+	//
+	if (abort_message)
+	{
+		DCU_abort(abort_message);
+	}
+
+	return drained;
+}
+
+//
+// the first abort message of the applied releases is kept in abort_message, the block is not released
+//
+void DCU_applyEvent(DCU_Event const& event, char const*& abort_message)
+{
+	if (event.operation)
+	{
+		DCU_trackRequest(event.operation);
+		return;
+	}
+
+	char const* release_abort_message = 0;
+	DCU_ReleaseStatus status = DCU_trackRelease(event.type, (void*) event.memory_address, 0, event.size, release_abort_message);
+
+	if (status == DCU_ReleaseUnallocated)
+	{
+		DCU_addPendingRelease(event);
+	}
+	else if (release_abort_message)
+	{
+		if (!abort_message)
+		{
+			abort_message = release_abort_message;
+		}
+	}
+	else
+	{
+		DCU_releaseTrackedBlock(status, (void*) event.memory_address, 0);
+	}
+}
+
+void DCU_applyEventNow(DCU_Event const& event)
+{
+	char const* abort_message = 0;
+	DCU_applyEvent(event, abort_message);
+	if (abort_message)
+	{
+		DCU_abort(abort_message);
+	}
+}
+
+void DCU_addPendingRelease(DCU_Event const& event)
+{
+	DCU_PendingRelease* pending = (DCU_PendingRelease*) DCU_metadataMalloc(sizeof(DCU_PendingRelease));
+	if (!pending)
+	{
+		//
+		// the release can't wait for its request, it's reported as unallocated like after the last retry
+		//
+		char const* abort_message = 0;
+		if ((event.type != DCU_ReallocType) && !DCU_untracked_requests)
+		{
+			DCU_registerProblem(DCU_getShard(event.memory_address), DCU_ReleaseUnallocatedType, DCU_NULL_STACK, DCU_NULL_STACK);
+
+#ifdef DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
+			abort_message = "Abnormal program termination : 'Release Unallocated Memory'\n";
+#endif //DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
+		}
+
+		DCU_releaseTrackedBlock(DCU_ReleaseUnallocated, (void*) event.memory_address, abort_message);
+		return;
+	}
+
+	pending->memory_address = event.memory_address;
+	pending->type = event.type;
+	pending->rounds = 0;
+	pending->size = event.size;
+
+	DCU_MutexScopedLock lock(DCU_pending_mutex);
+	pending->next = DCU_pending_releases;
+	DCU_pending_releases = pending;
+}
+
+void DCU_retryPendingReleases(bool const final_round)
+{
+	DCU_PendingRelease* pending = 0;
+	{
+		DCU_MutexScopedLock lock(DCU_pending_mutex);
+		pending = DCU_pending_releases;
+		DCU_pending_releases = 0;
+	}
+
+	DCU_PendingRelease* retry = 0;
+	DCU_PendingRelease* retry_last = 0;
+
+	while (pending)
+	{
+		DCU_PendingRelease* next = pending->next;
+
+		char const* abort_message = 0;
+		DCU_ReleaseStatus status = DCU_trackRelease(pending->type, (void*) pending->memory_address, 0, pending->size, abort_message);
+
+		if ((status == DCU_ReleaseUnallocated) && !final_round && (++pending->rounds != DCU_ASYNC_RETRY_ROUNDS))
+		{
+			pending->next = retry;
+			retry = pending;
+			if (!retry_last)
+			{
+				retry_last = pending;
+			}
+		}
+		else if ((status == DCU_ReleaseUnallocated) && DCU_unknownIsUntracked())
+		{
+			DCU_releaseUntracked(pending->type, (void*) pending->memory_address);
+			DCU_metadataFree(pending);
+		}
+		else
+		{
+			if (status == DCU_ReleaseUnallocated)
+			{
+				//
+				// realloc of an unknown block is not reported by the synchronous path either,
+				// nor releases that may be of untracked blocks
+				//
+				if ((pending->type != DCU_ReallocType) && !DCU_untracked_requests)
+				{
+					DCU_registerProblem(DCU_getShard(pending->memory_address), DCU_ReleaseUnallocatedType, DCU_NULL_STACK, DCU_NULL_STACK);
+
+#ifdef DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
+					abort_message = "Abnormal program termination : 'Release Unallocated Memory'\n";
+#endif //DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
+				}
+			}
+
+			DCU_releaseTrackedBlock(status, (void*) pending->memory_address, abort_message);
+			DCU_metadataFree(pending);
+		}
+
+		pending = next;
+	}
+
+	if (retry)
+	{
+		DCU_MutexScopedLock lock(DCU_pending_mutex);
+		retry_last->next = DCU_pending_releases;
+		DCU_pending_releases = retry;
+	}
+}
+
+void DCU_releaseTrackedBlock(DCU_ReleaseStatus const status, void* pointer, char const* abort_message)
+{
+	if (abort_message)
+	{
+		DCU_abort(abort_message);
+		return;
+	}
+
+	//
+	// unallocated blocks don't belong to any mspace
+	//
+	if (status != DCU_ReleaseUnallocated)
+	{
+		DCU_blockFree(pointer);
+	}
+}
+
+void DCU_forkChild()
+{
+	//
+	// the tracker thread doesn't exist in the child, the next event starts a new one
+	//
+	pthread_mutex_init(&DCU_rings_mutex, 0);
+	pthread_mutex_init(&DCU_pending_mutex, 0);
+	if (__atomic_load_n(&DCU_tracker_state, __ATOMIC_ACQUIRE) != DCU_TrackerSynchronous)
+	{
+		DCU_tracker_state = DCU_TrackerStopped;
+	}
+	DCU_untraced_thread = false;
+}
+#endif //DCU_ASYNC_TRACKING
+
+#ifdef DCU_PASSTHROUGH
+
+void DCU_resolveNextAllocator()
+{
+	DCU_NextAllocator next;
+	next.malloc = (void* (*)(size_t)) dlsym(RTLD_NEXT, "malloc");
+	next.free = (void (*)(void*)) dlsym(RTLD_NEXT, "free");
+	next.realloc = (void* (*)(void*, size_t)) dlsym(RTLD_NEXT, "realloc");
+	next.calloc = (void* (*)(size_t, size_t)) dlsym(RTLD_NEXT, "calloc");
+	next.memalign = (void* (*)(size_t, size_t)) dlsym(RTLD_NEXT, "memalign");
+	next.usable_size = (size_t (*)(void*)) dlsym(RTLD_NEXT, "malloc_usable_size");
+
+	if (!next.malloc || !next.free || !next.realloc || !next.calloc || !next.memalign || !next.usable_size)
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unable to find the next allocator\n");
+		_exit(1);
+	}
+
+	DCU_next_allocator = next;
+}
+
+#endif //DCU_PASSTHROUGH
+
+//
+// Bootstrap arena management
+//
+void* DCU_bootstrapMalloc(size_t size, size_t alignment)
+{
+	if (alignment < 2 * sizeof(size_t))
+	{
+		alignment = 2 * sizeof(size_t);
+	}
+
+	uintptr_t const base = (uintptr_t) DCU_bootstrap_arena;
+	size_t used = __atomic_load_n(&DCU_bootstrap_arena_used, __ATOMIC_RELAXED);
+	uintptr_t address = 0;
+	do
+	{
+		address = (base + used + sizeof(size_t) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		if ((address + size) > (base + DCU_BOOTSTRAP_ARENA_SIZE))
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp bootstrap arena exhausted\n");
+			_exit(1);
+		}
+	}
+	while (!__atomic_compare_exchange_n(&DCU_bootstrap_arena_used, &used, address + size - base, true,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	*((size_t*) address - 1) = size;
+	return (void*) address;
+}
+
+//
+// the arena is static and never reused, its blocks are zeroed
+//
+void* DCU_bootstrapRequest(size_t size, void* pointer, size_t const alignment)
+{
+	if (!size)
+	{
+		return 0;
+	}
+
+	void* out = DCU_bootstrapMalloc(size, alignment);
+	if (pointer)
+	{
+		size_t const old_size = DCU_bootstrapSize(pointer);
+		memcpy(out, pointer, (old_size < size) ? old_size : size);
+	}
+
+	return out;
+}
+
+//
+// reallocation of an arena block, the new block is requested as a malloc
+//
+void* DCU_leaveBootstrapArena(size_t size, void* pointer, DCU_ConstPointer const caller)
+{
+	if (!size)
+	{
+		return 0;
+	}
+
+	void* out = DCU_requestMemory(DCU_MallocType, size, 0, caller, 0, 0);
+	if (out)
+	{
+		size_t const old_size = DCU_bootstrapSize(pointer);
+		memcpy(out, pointer, (old_size < size) ? old_size : size);
+	}
+
+	return out;
+}
+
+inline size_t DCU_bootstrapSize(void* p)
+{
+	return *((size_t*) p - 1);
+}
+
+inline bool DCU_inBootstrapArena(void* p)
+{
+	return ((char*) p >= DCU_bootstrap_arena) && ((char*) p < (DCU_bootstrap_arena + DCU_BOOTSTRAP_ARENA_SIZE));
+}
+
+#ifdef DCU_MMAP_TRACKING
+//
+// Mapped regions management
+//
+void DCU_requestMapping(void* address, size_t length, bool const anonymous, DCU_ConstPointer const caller)
+{
+	DCU_initialize();
+
+	if (!DCU_THREAD_TRACING)
+	{
+		return;
+	}
+
+	DCU_MemoryInt const start = DCU_MemoryInt(address);
+	DCU_MemoryInt const end = start + DCU_pageRound(length);
+
+	bool const record = anonymous && DCU_threadChecksProblems();
+	DCU_StackId const stack = record ? DCU_createStackTrace(caller) : DCU_NULL_STACK;
+
+	DCU_MutexScopedLock lock(DCU_mappings_mutex);
+
+	//
+	// a fixed mapping replaces whatever was mapped on its range
+	//
+	DCU_StackId replaced_stack = DCU_NULL_STACK;
+	bool partial = false;
+	DCU_removeRegions(start, end, replaced_stack, partial);
+
+	if (anonymous)
+	{
+		DCU_updateStats(DCU_mapping_stats[DCU_MmapType], end - start, DCU_WEIGHT_ONE, true);
+	}
+
+	if (record)
+	{
+		DCU_Mapping* mapping = (DCU_Mapping*) DCU_metadataMalloc(sizeof(DCU_Mapping));
+		if (mapping)
+		{
+			mapping->stack = stack;
+			mapping->length = 0;
+			mapping->regions = 0;
+			mapping->unmapping = 0;
+			mapping->reported = false;
+
+			if (!DCU_insertRegion(start, end, mapping))
+			{
+				DCU_metadataFree(mapping);
+			}
+		}
+	}
+}
+
+void DCU_releaseMapping(void* address, size_t length, DCU_ConstPointer const caller)
+{
+	DCU_initialize();
+
+	//
+	// untraced threads still take the regions off the list
+	//
+	if (!DCU_STATE(DCU_TRACING))
+	{
+		return;
+	}
+
+	DCU_MemoryInt const start = DCU_MemoryInt(address);
+	DCU_StackId stack = DCU_NULL_STACK;
+	bool partial = false;
+	{
+		DCU_MutexScopedLock lock(DCU_mappings_mutex);
+		DCU_MemoryInt const removed = DCU_removeRegions(start, start + DCU_pageRound(length), stack, partial);
+		if (removed)
+		{
+			DCU_updateStats(DCU_mapping_stats[DCU_MunmapType], removed, DCU_WEIGHT_ONE, false);
+		}
+	}
+
+	if (partial && DCU_THREAD_TRACING && DCU_threadChecksProblems())
+	{
+		DCU_registerProblem(DCU_getShard(address), DCU_PartialUnmapType, stack, DCU_createStackTrace(caller));
+	}
+}
+
+void DCU_moveMapping(void* old_address, size_t old_length, void* new_address, size_t new_length)
+{
+	DCU_initialize();
+
+	if (!DCU_STATE(DCU_TRACING))
+	{
+		return;
+	}
+
+	DCU_MemoryInt const old_start = DCU_MemoryInt(old_address);
+	DCU_MemoryInt const new_start = DCU_MemoryInt(new_address);
+
+	DCU_MutexScopedLock lock(DCU_mappings_mutex);
+
+	//
+	// only tracked regions are followed, the mapping is held while its old range is taken off
+	//
+	unsigned int const index = DCU_findRegion(old_start);
+	DCU_Mapping* mapping = ((index != DCU_regions_count) && (DCU_regions[index].start <= old_start)) ?
+			DCU_regions[index].mapping : 0;
+	if (mapping)
+	{
+		mapping->regions += 1;
+	}
+
+	DCU_StackId stack = DCU_NULL_STACK;
+	bool partial = false;
+	DCU_removeRegions(old_start, old_start + DCU_pageRound(old_length), stack, partial);
+	DCU_removeRegions(new_start, new_start + DCU_pageRound(new_length), stack, partial);
+
+	if (mapping)
+	{
+		DCU_updateStats(DCU_mapping_stats[DCU_MremapType], DCU_pageRound(new_length), DCU_WEIGHT_ONE, true);
+		DCU_insertRegion(new_start, new_start + DCU_pageRound(new_length), mapping);
+		DCU_dropRegion(mapping);
+	}
+}
+
+inline DCU_MemoryInt DCU_pageRound(size_t length)
+{
+	return (DCU_MemoryInt(length) + DCU_page_size - 1) & ~(DCU_page_size - 1);
+}
+
+//
+// first region ending after address
+//
+unsigned int DCU_findRegion(DCU_MemoryInt const address)
+{
+	unsigned int low = 0;
+	unsigned int high = DCU_regions_count;
+
+	while (low != high)
+	{
+		unsigned int middle = (low + high) / 2;
+		if (DCU_regions[middle].end <= address)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+//
+// makes room for one more region, the list is left as it is when it can't grow
+//
+bool DCU_reserveRegion()
+{
+	if (DCU_regions_count != DCU_regions_capacity)
+	{
+		return true;
+	}
+
+	unsigned int capacity = DCU_regions_capacity ? (DCU_regions_capacity * 2) : DCU_MAPPINGS_INITIAL_CAPACITY;
+	DCU_MappedRegion* regions = (DCU_MappedRegion*) DCU_metadataMalloc(capacity * sizeof(DCU_MappedRegion));
+	if (!regions)
+	{
+		return false;
+	}
+
+	if (DCU_regions)
+	{
+		memcpy(regions, DCU_regions, DCU_regions_count * sizeof(DCU_MappedRegion));
+		DCU_metadataFree(DCU_regions);
+	}
+
+	DCU_regions = regions;
+	DCU_regions_capacity = capacity;
+	return true;
+}
+
+bool DCU_insertRegion(DCU_MemoryInt const start, DCU_MemoryInt const end, DCU_Mapping* mapping)
+{
+	if (!DCU_reserveRegion())
+	{
+		return false;
+	}
+
+	unsigned int index = DCU_findRegion(start);
+	memmove(DCU_regions + index + 1, DCU_regions + index, (DCU_regions_count - index) * sizeof(DCU_MappedRegion));
+	DCU_regions[index].start = start;
+	DCU_regions[index].end = end;
+	DCU_regions[index].mapping = mapping;
+	DCU_regions_count += 1;
+
+	if (!mapping->regions)
+	{
+		DCU_mappings_count += 1;
+	}
+	mapping->regions += 1;
+	mapping->length += end - start;
+	DCU_mapped_bytes += end - start;
+	return true;
+}
+
+//
+// the mapping goes away with its last region
+//
+void DCU_dropRegion(DCU_Mapping* mapping)
+{
+	mapping->regions -= 1;
+	if (!mapping->regions)
+	{
+		DCU_mappings_count -= 1;
+		DCU_metadataFree(mapping);
+	}
+}
+
+//
+// takes [start, end) off the regions, returns the bytes removed and the stack of the first mapping
+// left in pieces (or of the first mapping removed when none is)
+//
+DCU_MemoryInt DCU_removeRegions(DCU_MemoryInt const start, DCU_MemoryInt const end, DCU_StackId& stack, bool& partial)
+{
+	unsigned int const first = DCU_findRegion(start);
+
+	//
+	// a mapping is only unmapped whole when every one of its regions is taken off
+	//
+	for (unsigned int index = first; (index != DCU_regions_count) && (DCU_regions[index].start < end); ++index)
+	{
+		DCU_MappedRegion const& region = DCU_regions[index];
+		if ((region.start >= start) && (region.end <= end))
+		{
+			region.mapping->unmapping += 1;
+		}
+	}
+
+	DCU_MemoryInt removed = 0;
+	unsigned int index = first;
+	while ((index != DCU_regions_count) && (DCU_regions[index].start < end))
+	{
+		DCU_MappedRegion& region = DCU_regions[index];
+		DCU_Mapping* mapping = region.mapping;
+		bool const cut = (region.start < start) || (region.end > end);
+		bool const pieces_left = cut || (mapping->unmapping < mapping->regions);
+
+		if ((pieces_left && !partial) || (!pieces_left && (stack == DCU_NULL_STACK) && !partial))
+		{
+			stack = mapping->stack;
+		}
+		partial |= pieces_left;
+
+		DCU_MemoryInt taken = 0;
+		if (!cut)
+		{
+			taken = region.end - region.start;
+			memmove(DCU_regions + index, DCU_regions + index + 1, (DCU_regions_count - index - 1) * sizeof(DCU_MappedRegion));
+			DCU_regions_count -= 1;
+			mapping->unmapping -= 1;
+			mapping->length -= taken;
+			DCU_dropRegion(mapping);
+		}
+		else if ((region.start < start) && (region.end > end))
+		{
+			//
+			// a hole in the middle splits the region, both pieces stay on the mapping
+			// the room for the tail is made first, DCU_reserveRegion() can move the list
+			// without it the tail is no longer tracked and only the head is kept
+			//
+			DCU_MemoryInt const tail_end = region.end;
+			bool const split = DCU_reserveRegion();
+			taken = end - start;
+			DCU_regions[index].end = start;
+			mapping->length -= tail_end - start;
+			DCU_mapped_bytes -= tail_end - start;
+			if (split)
+			{
+				DCU_insertRegion(end, tail_end, mapping);
+				index += 1;
+			}
+			index += 1;
+			removed += taken;
+			continue;
+		}
+		else if (region.start < start)
+		{
+			taken = region.end - start;
+			region.end = start;
+			mapping->length -= taken;
+			index += 1;
+		}
+		else
+		{
+			taken = end - region.start;
+			region.start = end;
+			mapping->length -= taken;
+			index += 1;
+		}
+
+		removed += taken;
+		DCU_mapped_bytes -= taken;
+	}
+
+	return removed;
+}
+
+void DCU_registerMappingLeaks()
+{
+	DCU_MutexScopedLock lock(DCU_mappings_mutex);
+
+	for (unsigned int i = 0; i != DCU_regions_count; ++i)
+	{
+		DCU_Mapping* mapping = DCU_regions[i].mapping;
+		if (mapping->reported)
+		{
+			continue;
+		}
+		mapping->reported = true;
+
+		DCU_ProblemInfo* problem = DCU_findProblem(DCU_problems, DCU_MappingLeakType, mapping->stack, DCU_NULL_STACK);
+		if (!problem)
+		{
+			problem = DCU_createProblem();
+			problem->type = DCU_MappingLeakType;
+			problem->allocation_stack = mapping->stack;
+			DCU_addProblem(DCU_problems, problem);
+		}
+		problem->count += DCU_WEIGHT_ONE;
+		problem->size = mapping->length;
+		problem->total_memory += mapping->length;
+	}
+}
+#endif //DCU_MMAP_TRACKING
+
+#ifdef DCU_THREAD_MSPACES
+//
+// Thread mspace management
+//
+inline mspace DCU_getThreadSpace()
+{
+	if (DCU_thread_space)
+	{
+		return DCU_thread_space;
+	}
+
+	return DCU_acquireThreadSpace();
+}
+
+mspace DCU_acquireThreadSpace()
+{
+	mspace space = memory_space;
+
+	{
+		DCU_MutexScopedLock lock(DCU_thread_spaces_mutex);
+
+		unsigned int i = 0;
+		while ((i != DCU_thread_spaces_count) && DCU_thread_space_used[i])
+		{
+			++i;
+		}
+
+		if (i != DCU_thread_spaces_count)
+		{
+			space = DCU_thread_spaces[i];
+			DCU_thread_space_used[i] = true;
+		}
+		else if (DCU_thread_spaces_count != DCU_MAX_THREAD_SPACES)
+		{
+			space = create_mspace(0, 1);
+			DCU_thread_spaces[DCU_thread_spaces_count] = space;
+			DCU_thread_space_used[DCU_thread_spaces_count] = true;
+			++DCU_thread_spaces_count;
+		}
+	}
+
+	//
+	// when every slot is taken the thread shares memory_space
+	//
+	DCU_thread_space = space;
+	if (space != memory_space)
+	{
+		pthread_setspecific(DCU_thread_space_key, space);
+	}
+
+	return space;
+}
+
+void DCU_releaseThreadSpace(void* space)
+{
+	//
+	// late requests of the finished thread still use its mspace, mspaces are locked so sharing is safe
+	//
+	DCU_MutexScopedLock lock(DCU_thread_spaces_mutex);
+	for (unsigned int i = 0; i != DCU_thread_spaces_count; ++i)
+	{
+		if (DCU_thread_spaces[i] == space)
+		{
+			DCU_thread_space_used[i] = false;
+		}
+	}
+}
+#endif //DCU_THREAD_MSPACES
+
+//
+// Hash table management
+//
+inline void DCU_addMemory(DCU_Shard& shard, DCU_OperationInfo* element)
+{
+	if (element)
+	{
+#ifdef DCU_INLINE_HEADERS
+		//
+		// the operation only lives on the header from now on
+		//
+		DCU_InlineHeader* header = DCU_getInlineHeader(element->memory_address);
+		header->size = element->size;
+		header->type = element->type;
+		header->sampled = element->sampled;
+		header->stack = element->stack;
+		DCU_destroyOperation(element);
+
+		if (shard.blocks)
+		{
+			shard.blocks->previous = &header->next;
+		}
+		header->next = shard.blocks;
+		header->previous = &shard.blocks;
+		shard.blocks = header;
+		header->magic = DCU_INLINE_MAGIC(header);
+#else
+
+#ifdef DCU_LOCK_FREE_TABLE
+		if (DCU_addLockFreeMemory(element))
+		{
+			return;
+		}
+
+		__sync_fetch_and_add(&DCU_lock_free_overflow, 1);
+		__sync_fetch_and_add(&DCU_lock_free_overflowed, 1);
+		DCU_MutexScopedLock lock(shard.mutex);
+#endif //DCU_LOCK_FREE_TABLE
+
+		DCU_tableInsert(shard.memory, element);
+#endif //DCU_INLINE_HEADERS
+	}
+}
+
+inline DCU_OperationInfo* DCU_takeMemory(DCU_Shard& shard, DCU_ConstPointer memory_address)
+{
+#ifdef DCU_INLINE_HEADERS
+	(void) shard;
+	DCU_InlineHeader* header = DCU_findInlineHeader(memory_address);
+	if (!header)
+	{
+		return 0;
+	}
+
+	*header->previous = header->next;
+	if (header->next)
+	{
+		header->next->previous = header->previous;
+	}
+	header->magic = 0;
+
+	//
+	// without a record to unpack to, the block leaves the tracker untracked
+	//
+	DCU_OperationInfo* element = DCU_createOperation();
+	if (!element)
+	{
+		__sync_fetch_and_add(&DCU_untracked_requests, 1);
+		return 0;
+	}
+
+	DCU_unpackHeader(header, element);
+	return element;
+#else
+
+#ifdef DCU_LOCK_FREE_TABLE
+	DCU_OperationInfo* element = DCU_takeLockFreeMemory(memory_address);
+	if (element || !__atomic_load_n(&DCU_lock_free_overflow, __ATOMIC_ACQUIRE))
+	{
+		return element;
+	}
+
+	DCU_MutexScopedLock lock(shard.mutex);
+	element = DCU_tableTake(shard.memory, memory_address);
+	if (element)
+	{
+		__sync_fetch_and_sub(&DCU_lock_free_overflow, 1);
+	}
+
+	return element;
+#else
+	return DCU_tableTake(shard.memory, memory_address);
+#endif //DCU_LOCK_FREE_TABLE
+#endif //DCU_INLINE_HEADERS
+}
+
+size_t DCU_findMemorySize(DCU_Shard& shard, DCU_ConstPointer memory_address)
+{
+#ifdef DCU_INLINE_HEADERS
+	(void) shard;
+	DCU_InlineHeader* header = DCU_findInlineHeader(memory_address);
+	return header ? size_t(header->size) : 0;
+#else
+
+#ifdef DCU_LOCK_FREE_TABLE
+	size_t size = DCU_findLockFreeSize(memory_address);
+	if (size || !__atomic_load_n(&DCU_lock_free_overflow, __ATOMIC_ACQUIRE))
+	{
+		return size;
+	}
+
+	DCU_MutexScopedLock lock(shard.mutex);
+#endif //DCU_LOCK_FREE_TABLE
+
+	return DCU_tableFindSize(shard.memory, memory_address);
+#endif //DCU_INLINE_HEADERS
+}
+
+inline void DCU_emptyMemory()
+{
+	for (unsigned int i = 0; i != DCU_SHARD_COUNT; ++i)
+	{
+#ifdef DCU_INLINE_HEADERS
+		//
+		// leaked blocks keep their records, later releases are no longer traced
+		//
+		DCU_shards[i].blocks = 0;
+#else
+		DCU_tableDestroy(DCU_shards[i].memory);
+#endif //DCU_INLINE_HEADERS
+	}
+
+#ifdef DCU_LOCK_FREE_TABLE
+	//
+	// the table itself stays mapped, late releases may still probe it
+	//
+	for (HastIterator slot = 0; slot != DCU_LOCK_FREE_TABLE_SIZE; ++slot)
+	{
+		DCU_OperationInfo* operation = __atomic_load_n(&DCU_lock_free_table[slot].value, __ATOMIC_ACQUIRE);
+		if (operation && __sync_bool_compare_and_swap(&DCU_lock_free_table[slot].value, operation, (DCU_OperationInfo*) 0))
+		{
+			DCU_destroyOperation(operation);
+		}
+	}
+#endif //DCU_LOCK_FREE_TABLE
+}
+
+//
+// User block headers
+//
+inline DCU_Pointer DCU_toBlock(DCU_Pointer chunk)
+{
+#ifdef DCU_INLINE_HEADERS
+	if (chunk)
+	{
+		//
+		// not on any list until the request is tracked
+		//
+		DCU_InlineHeader* header = (DCU_InlineHeader*) chunk;
+		header->magic = 0;
+		header->alignment_shift = 0;
+		return header + 1;
+	}
+#endif //DCU_INLINE_HEADERS
+
+	return chunk;
+}
+
+//
+// alignment is a power of two, with headers the chunk is padded so the header ends on it
+//
+DCU_Pointer DCU_blockMemalign(size_t const alignment, size_t const size)
+{
+	if (alignment <= MALLOC_ALIGNMENT)
+	{
+		return DCU_blockMalloc(size);
+	}
+
+#ifdef DCU_INLINE_HEADERS
+	size_t const padding = ((DCU_BLOCK_HEADER_SIZE + alignment - 1) & ~(alignment - 1)) - DCU_BLOCK_HEADER_SIZE;
+	DCU_Pointer chunk = DCU_memalign(alignment, size + padding + DCU_BLOCK_HEADER_SIZE);
+	if (chunk)
+	{
+		DCU_InlineHeader* header = (DCU_InlineHeader*) ((char*) chunk + padding);
+		header->magic = 0;
+		header->alignment_shift = __builtin_ctzl(alignment);
+		return header + 1;
+	}
+
+	return chunk;
+#else
+	return DCU_memalign(alignment, size);
+#endif //DCU_INLINE_HEADERS
+}
+
+#ifdef DCU_INLINE_HEADERS
+inline DCU_InlineHeader* DCU_getInlineHeader(DCU_ConstPointer memory_address)
+{
+	return ((DCU_InlineHeader*) memory_address) - 1;
+}
+
+DCU_InlineHeader* DCU_findInlineHeader(DCU_ConstPointer memory_address)
+{
+	DCU_MemoryInt address = DCU_MemoryInt(memory_address);
+	if ((address & (MALLOC_ALIGNMENT - 1)) || !DCU_readableBefore(address, sizeof(DCU_InlineHeader)))
+	{
+		return 0;
+	}
+
+	DCU_InlineHeader* header = DCU_getInlineHeader(memory_address);
+	if (header->magic != DCU_INLINE_MAGIC(header))
+	{
+		return 0;
+	}
+
+	return header;
+}
+
+//
+// the length bytes in front of address are read only inside the range mapped for the mspaces,
+// and only once the page they start on is known to be mapped
+//
+inline bool DCU_readableBefore(DCU_MemoryInt const address, size_t const length)
+{
+	if ((address < __atomic_load_n(&DCU_space_low, __ATOMIC_ACQUIRE) + length) ||
+		(address > __atomic_load_n(&DCU_space_high, __ATOMIC_ACQUIRE)))
+	{
+		return false;
+	}
+
+	DCU_MemoryInt const page = (address - length) & ~DCU_MemoryInt(DCU_INLINE_PAGE_SIZE - 1);
+	if (page != (address & ~DCU_MemoryInt(DCU_INLINE_PAGE_SIZE - 1)))
+	{
+		unsigned char residency;
+		if (mincore((void*) page, 1, &residency) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+inline size_t DCU_headerPadding(DCU_InlineHeader const* header)
+{
+	size_t const alignment = size_t(1) << header->alignment_shift;
+	return header->alignment_shift ? ((DCU_BLOCK_HEADER_SIZE + alignment - 1) & ~(alignment - 1)) - DCU_BLOCK_HEADER_SIZE : 0;
+}
+
+inline void DCU_unpackHeader(DCU_InlineHeader const* header, DCU_OperationInfo* element)
+{
+	element->next = 0;
+	element->memory_address = header + 1;
+	element->size = size_t(header->size);
+	element->type = DCU_DynamicOperationType(header->type);
+	element->sampled = header->sampled;
+	element->stack = header->stack;
+}
+#endif //DCU_INLINE_HEADERS
+
+#ifdef DCU_LOCK_FREE_TABLE
+//
+// Lock-free table management
+//
+bool DCU_addLockFreeMemory(DCU_OperationInfo* element)
+{
+	HastIterator slot = DCU_LOCK_FREE_HASH_FUNCTION(element->memory_address);
+
+	for (HastIterator probe = 0; probe != DCU_LOCK_FREE_MAX_PROBE; ++probe)
+	{
+		DCU_LockFreeSlot& entry = DCU_lock_free_table[slot];
+		DCU_ConstPointer key = __atomic_load_n(&entry.key, __ATOMIC_RELAXED);
+
+		if (((key == DCU_LOCK_FREE_EMPTY_KEY) || (key == DCU_LOCK_FREE_TOMBSTONE_KEY)) &&
+			__sync_bool_compare_and_swap(&entry.key, key, element->memory_address))
+		{
+			__atomic_store_n(&entry.value, element, __ATOMIC_RELEASE);
+
+			//
+			// a slot passed while busy may have been emptied since, it must not cut the chain
+			//
+			for (HastIterator previous = DCU_LOCK_FREE_HASH_FUNCTION(element->memory_address); previous != slot;
+					previous = (previous + 1) & (DCU_LOCK_FREE_TABLE_SIZE - 1))
+			{
+				__sync_bool_compare_and_swap(&DCU_lock_free_table[previous].key, DCU_LOCK_FREE_EMPTY_KEY, DCU_LOCK_FREE_TOMBSTONE_KEY);
+			}
+			return true;
+		}
+
+		slot = (slot + 1) & (DCU_LOCK_FREE_TABLE_SIZE - 1);
+	}
+
+	return false;
+}
+
+//
+// an empty slot ends a lookup only if no tombstone was emptied while probing
+//
+inline bool DCU_lockFreeMissed(unsigned int sequence)
+{
+	return !(sequence & 1) && (__atomic_load_n(&DCU_lock_free_reclaim_sequence, __ATOMIC_ACQUIRE) == sequence);
+}
+
+DCU_OperationInfo* DCU_takeLockFreeMemory(DCU_ConstPointer memory_address)
+{
+	unsigned int sequence = __atomic_load_n(&DCU_lock_free_reclaim_sequence, __ATOMIC_ACQUIRE);
+	HastIterator slot = DCU_LOCK_FREE_HASH_FUNCTION(memory_address);
+
+	for (HastIterator probe = 0; probe != DCU_LOCK_FREE_MAX_PROBE; ++probe)
+	{
+		DCU_LockFreeSlot& entry = DCU_lock_free_table[slot];
+		DCU_ConstPointer key = __atomic_load_n(&entry.key, __ATOMIC_ACQUIRE);
+
+		if (key == DCU_LOCK_FREE_EMPTY_KEY)
+		{
+			if (DCU_lockFreeMissed(sequence))
+			{
+				break;
+			}
+
+			sequence = __atomic_load_n(&DCU_lock_free_reclaim_sequence, __ATOMIC_ACQUIRE);
+			slot = DCU_LOCK_FREE_HASH_FUNCTION(memory_address);
+			probe = HastIterator(-1);
+			continue;
+		}
+
+		if (key == memory_address)
+		{
+			DCU_OperationInfo* element = __atomic_load_n(&entry.value, __ATOMIC_ACQUIRE);
+			if (element && __sync_bool_compare_and_swap(&entry.value, element, (DCU_OperationInfo*) 0))
+			{
+				__atomic_store_n(&entry.key, DCU_LOCK_FREE_TOMBSTONE_KEY, __ATOMIC_RELEASE);
+				DCU_reclaimLockFreeSlots(slot);
+				return element;
+			}
+
+			//
+			// another thread is releasing the same block
+			//
+			break;
+		}
+
+		slot = (slot + 1) & (DCU_LOCK_FREE_TABLE_SIZE - 1);
+	}
+
+	return 0;
+}
+
+//
+// the block can't be released meanwhile, that would be a use after free of the caller
+//
+size_t DCU_findLockFreeSize(DCU_ConstPointer memory_address)
+{
+	unsigned int sequence = __atomic_load_n(&DCU_lock_free_reclaim_sequence, __ATOMIC_ACQUIRE);
+	HastIterator slot = DCU_LOCK_FREE_HASH_FUNCTION(memory_address);
+
+	for (HastIterator probe = 0; probe != DCU_LOCK_FREE_MAX_PROBE; ++probe)
+	{
+		DCU_LockFreeSlot& entry = DCU_lock_free_table[slot];
+		DCU_ConstPointer key = __atomic_load_n(&entry.key, __ATOMIC_ACQUIRE);
+
+		if (key == DCU_LOCK_FREE_EMPTY_KEY)
+		{
+			if (DCU_lockFreeMissed(sequence))
+			{
+				break;
+			}
+
+			sequence = __atomic_load_n(&DCU_lock_free_reclaim_sequence, __ATOMIC_ACQUIRE);
+			slot = DCU_LOCK_FREE_HASH_FUNCTION(memory_address);
+			probe = HastIterator(-1);
+			continue;
+		}
+
+		if (key == memory_address)
+		{
+			DCU_OperationInfo* element = __atomic_load_n(&entry.value, __ATOMIC_ACQUIRE);
+			return element ? element->size : 0;
+		}
+
+		slot = (slot + 1) & (DCU_LOCK_FREE_TABLE_SIZE - 1);
+	}
+
+	return 0;
+}
+
+//
+// empties the tombstones ending at slot when the slot after them is empty, one thread at a time,
+// a chain passing through them would have an element after them
+//
+void DCU_reclaimLockFreeSlots(HastIterator slot)
+{
+	unsigned int sequence = __atomic_load_n(&DCU_lock_free_reclaim_sequence, __ATOMIC_RELAXED);
+	if ((sequence & 1) || !__sync_bool_compare_and_swap(&DCU_lock_free_reclaim_sequence, sequence, sequence + 1))
+	{
+		return;
+	}
+
+	HastIterator next = (slot + 1) & (DCU_LOCK_FREE_TABLE_SIZE - 1);
+	for (HastIterator probe = 0; probe != DCU_LOCK_FREE_MAX_PROBE; ++probe)
+	{
+		if (!__sync_bool_compare_and_swap(&DCU_lock_free_table[slot].key, DCU_LOCK_FREE_TOMBSTONE_KEY, DCU_LOCK_FREE_EMPTY_KEY))
+		{
+			break;
+		}
+
+		//
+		// an insert may have claimed the next slot meanwhile, then this one is still part of its chain
+		//
+		if (__sync_val_compare_and_swap(&DCU_lock_free_table[next].key, DCU_LOCK_FREE_EMPTY_KEY, DCU_LOCK_FREE_EMPTY_KEY) != DCU_LOCK_FREE_EMPTY_KEY)
+		{
+			__sync_bool_compare_and_swap(&DCU_lock_free_table[slot].key, DCU_LOCK_FREE_EMPTY_KEY, DCU_LOCK_FREE_TOMBSTONE_KEY);
+			break;
+		}
+
+		next = slot;
+		slot = (slot - 1) & (DCU_LOCK_FREE_TABLE_SIZE - 1);
+	}
+
+	__atomic_store_n(&DCU_lock_free_reclaim_sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+#endif //DCU_LOCK_FREE_TABLE
+
+//
+// DCU_ProblemRegistry Management
+//
+
+void DCU_initializeProblems(DCU_ProblemRegistry& registry)
+{
+	registry.list = 0;
+	registry.index = 0;
+	registry.capacity = 0;
+	registry.count = 0;
+}
+
+void DCU_emptyProblems(DCU_ProblemRegistry& registry)
+{
+	DCU_ProblemInfo* remove = DCU_takeProblems(registry);
+	while (remove)
+	{
+		DCU_ProblemInfo* next = remove->next;
+		DCU_destroyProblem(remove);
+		remove = next;
+	}
+}
+
+DCU_ProblemInfo* DCU_takeProblems(DCU_ProblemRegistry& registry)
+{
+	DCU_ProblemInfo* list = registry.list;
+	if (registry.index)
+	{
+		DCU_metadataFree(registry.index);
+	}
+
+	DCU_initializeProblems(registry);
+	return list;
+}
+
+void DCU_addProblem(DCU_ProblemRegistry& registry, DCU_ProblemInfo* element)
+{
+	element->next = registry.list;
+	registry.list = element;
+	registry.count += 1;
+
+	if (registry.count > registry.capacity)
+	{
+		DCU_growProblemIndex(registry);
+	}
+	else
+	{
+		HastIterator bucket = DCU_hashProblem(element->type, element->allocation_stack, element->deallocation_stack) & (registry.capacity - 1);
+		element->bucket_next = registry.index[bucket];
+		registry.index[bucket] = element;
+	}
+}
+
+void DCU_registerProblem(DCU_Shard& shard, DCU_ProblemType const type,
+		DCU_StackId const allocation_stack, DCU_StackId const deallocation_stack)
+{
+	DCU_MutexScopedLock lock(shard.mutex);
+
+	DCU_ProblemInfo* problem = DCU_findProblem(shard.problems, type, allocation_stack, deallocation_stack);
+	if (!problem)
+	{
+		problem = DCU_createProblem();
+		if (!problem)
+		{
+			__sync_fetch_and_add(&DCU_lost_problems, 1);
+			return;
+		}
+
+		problem->type = type;
+		problem->allocation_stack = allocation_stack;
+		problem->deallocation_stack = deallocation_stack;
+		DCU_addProblem(shard.problems, problem);
+	}
+
+	problem->count += DCU_WEIGHT_ONE;
+}
+
+void DCU_registerLeak(DCU_OperationInfo* operation)
+{
+	DCU_ProblemInfo* problem = DCU_findProblem(DCU_problems, DCU_LeakType, operation->stack, DCU_NULL_STACK);
+	if (!problem)
+	{
+		problem = DCU_createProblem();
+		if (!problem)
+		{
+			__sync_fetch_and_add(&DCU_lost_problems, 1);
+			return;
+		}
+
+		problem->type = DCU_LeakType;
+		problem->allocation_stack = operation->stack;
+		DCU_addProblem(DCU_problems, problem);
+	}
+	DCU_MemoryInt const weight = DCU_operationWeight(operation);
+	problem->count += weight;
+	problem->size = operation->size;
+	problem->total_memory += DCU_weightedSize(operation->size, weight);
+}
+
+DCU_ProblemInfo* DCU_findProblem(DCU_ProblemRegistry& registry, DCU_ProblemType const type,
+		DCU_StackId const allocation_stack, DCU_StackId const deallocation_stack)
+{
+	DCU_ProblemInfo* iterator = registry.list;
+	if (registry.index)
+	{
+		iterator = registry.index[DCU_hashProblem(type, allocation_stack, deallocation_stack) & (registry.capacity - 1)];
+	}
+
+	bool not_found = true;
+
+	while(not_found && iterator)
+	{
+		not_found = ( (iterator->type != type)
+					|| (iterator->allocation_stack != allocation_stack)
+					|| (iterator->deallocation_stack != deallocation_stack) );
+
+		if (not_found)
+		{
+			iterator = registry.index ? iterator->bucket_next : iterator->next;
+		}
+	}
+
+	return iterator;
+}
+
+inline HastIterator DCU_hashProblem(DCU_ProblemType const type, DCU_StackId const allocation_stack, DCU_StackId const deallocation_stack)
+{
+	HastIterator hash = allocation_stack;
+	hash = (hash * HastIterator(0x9E3779B97F4A7C15ULL)) ^ deallocation_stack;
+	hash = (hash * HastIterator(0x9E3779B97F4A7C15ULL)) ^ type;
+	return DCU_foldHash(hash * HastIterator(0x9E3779B97F4A7C15ULL));
+}
+
+void DCU_growProblemIndex(DCU_ProblemRegistry& registry)
+{
+	HastIterator capacity = registry.capacity ? (registry.capacity * 2) : DCU_PROBLEM_INDEX_INITIAL_CAPACITY;
+	DCU_ProblemInfo** index = (DCU_ProblemInfo**) DCU_metadataMalloc(capacity * sizeof(DCU_ProblemInfo*));
+
+	if (registry.index)
+	{
+		DCU_metadataFree(registry.index);
+	}
+
+	registry.index = index;
+	registry.capacity = index ? capacity : 0;
+	if (!index)
+	{
+		//
+		// lookups walk the list, the next problem tries to build the index again
+		//
+		return;
+	}
+
+	memset(index, 0, capacity * sizeof(DCU_ProblemInfo*));
+	for (DCU_ProblemInfo* iterator = registry.list; iterator; iterator = iterator->next)
+	{
+		HastIterator bucket = DCU_hashProblem(iterator->type, iterator->allocation_stack, iterator->deallocation_stack) & (capacity - 1);
+		iterator->bucket_next = index[bucket];
+		index[bucket] = iterator;
+	}
+}
+
+inline DCU_StackId DCU_createStackTrace(DCU_ConstPointer const caller)
+{
+	//
+	// callers missing from the site profile aren't unwound
+	//
+	if ((DCU_site_profile_mode != DCU_SiteProfileOff) && !DCU_isProfiledCaller(caller))
+	{
+		return DCU_internStack(&caller, 1, false);
+	}
+
+	DCU_ConstPointer stack[DCU_STACK_MAX_DEPTH + DCU_STACK_SKIP_LIMIT];
+	unsigned int const size = DCU_stack_depth + DCU_STACK_SKIP_LIMIT;
+	unsigned int depth = 0;
+
+	bool captured = false;
+	if (DCU_unwinder == DCU_FramePointerUnwinder)
+	{
+		captured = DCU_walkFramePointers(stack, size, depth);
+	}
+	else if (DCU_unwinder == DCU_DwarfUnwinder)
+	{
+		captured = DCU_walkCachedFrames(stack, size, depth);
+	}
+
+	if (!captured)
+	{
+		if (DCU_unwinder != DCU_BacktraceUnwinder)
+		{
+			__sync_fetch_and_add(&DCU_unwind_fallbacks, 1);
+		}
+
+		int frames = backtrace((void**)(stack), int(size));
+		depth = (frames > 0) ? (unsigned int) frames : 0;
+	}
+
+	//
+	// tracker frames come before the hook's caller, the whole stack is kept when it isn't found
+	//
+	unsigned int first = 0;
+	while ((first != depth) && (first <= DCU_STACK_SKIP_LIMIT) && (stack[first] != caller))
+	{
+		++first;
+	}
+
+	if ((first == depth) || (first > DCU_STACK_SKIP_LIMIT))
+	{
+		first = 0;
+	}
+
+	depth -= first;
+	if (depth > DCU_stack_depth)
+	{
+		depth = DCU_stack_depth;
+	}
+
+	return DCU_internStack(stack + first, depth, false);
+}
+
+//
+// sites are interned as one frame stacks, a descriptor can't be a return address
+//
+inline DCU_StackId DCU_createSiteStack(DCU_Site const* site)
+{
+	DCU_ConstPointer frame = site;
+	return DCU_internStack(&frame, 1, true);
+}
+
+void DCU_selectUnwinder()
+{
+	char const* name = getenv(DCU_UNWINDER_VARIABLE);
+	if (!name)
+	{
+		return;
+	}
+
+	for (unsigned int i = 0; i != DCU_UNWINDER_TYPES; ++i)
+	{
+		if (!strcmp(name, DCU_UnwinderTypeNames[i]))
+		{
+			DCU_unwinder = DCU_UnwinderType(i);
+			return;
+		}
+	}
+
+	fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp unknown %s '%s', using %s\n", DCU_UNWINDER_VARIABLE, name,
+			DCU_UnwinderTypeNames[DCU_unwinder]);
+}
+
+void DCU_selectStackDepth()
+{
+	char const* value = getenv(DCU_STACK_DEPTH_VARIABLE);
+	if (!value)
+	{
+		return;
+	}
+
+	char* end = 0;
+	unsigned long depth = strtoul(value, &end, 10);
+	if (!*value || *end || !depth || (depth > DCU_STACK_MAX_DEPTH))
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp %s must be between 1 and %d, using %u\n", DCU_STACK_DEPTH_VARIABLE,
+				DCU_STACK_MAX_DEPTH, DCU_stack_depth);
+		return;
+	}
+
+	DCU_stack_depth = (unsigned int) depth;
+}
+
+void DCU_selectSampleInterval()
+{
+	char const* value = getenv(DCU_SAMPLE_INTERVAL_VARIABLE);
+	if (!value)
+	{
+		return;
+	}
+
+	char* end = 0;
+	unsigned long interval = strtoul(value, &end, 10);
+	if (!*value || *end)
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp %s must be a number of bytes, tracking every request\n",
+				DCU_SAMPLE_INTERVAL_VARIABLE);
+		return;
+	}
+
+	if (interval)
+	{
+		DCU_sample_interval = interval;
+		DCU_default_policy = DCU_SampledTracking;
+		DCU_untracked_blocks = true;
+	}
+}
+
+void DCU_selectThreadPolicies()
+{
+	char const* value = getenv(DCU_THREAD_POLICY_VARIABLE);
+	if (!value)
+	{
+		return;
+	}
+
+	//
+	// "pattern=policy" rules separated by commas
+	//
+	while (*value)
+	{
+		size_t rule_size = strcspn(value, ",");
+		char const* separator = (char const*) memchr(value, '=', rule_size);
+		size_t pattern_size = separator ? size_t(separator - value) : 0;
+
+		DCU_ThreadPolicyRule& rule = DCU_thread_policy_rules[DCU_thread_policy_rules_count];
+		unsigned int policy = DCU_TRACKING_POLICIES;
+		if (separator && (pattern_size < DCU_THREAD_POLICY_PATTERN_SIZE))
+		{
+			size_t name_size = rule_size - pattern_size - 1;
+			for (policy = 0; policy != DCU_TRACKING_POLICIES; ++policy)
+			{
+				if ((strlen(DCU_TrackingPolicyNames[policy]) == name_size) &&
+					!strncmp(separator + 1, DCU_TrackingPolicyNames[policy], name_size))
+				{
+					break;
+				}
+			}
+		}
+
+		if (policy == DCU_TRACKING_POLICIES)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp %s rule '%.*s' ignored\n", DCU_THREAD_POLICY_VARIABLE,
+					int(rule_size), value);
+		}
+		else if (DCU_thread_policy_rules_count == DCU_THREAD_POLICY_RULES)
+		{
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp %s has more than %d rules\n", DCU_THREAD_POLICY_VARIABLE,
+					DCU_THREAD_POLICY_RULES);
+			return;
+		}
+		else
+		{
+			memcpy(rule.pattern, value, pattern_size);
+			rule.pattern[pattern_size] = 0;
+			rule.policy = DCU_TrackingPolicy(policy);
+			DCU_thread_policy_rules_count += 1;
+		}
+
+		value += rule_size + (value[rule_size] ? 1 : 0);
 	}
+}
 
-	if (type == DCU_CallocType)
+inline DCU_TrackingPolicy DCU_getThreadPolicy()
+{
+	if (__builtin_expect(DCU_thread_policy_generation != __atomic_load_n(&DCU_thread_names_generation, __ATOMIC_RELAXED), 0) &&
+		!DCU_thread_policy_set)
 	{
-		out = DCU_malloc(size  + OVERWRITE_DETECTION_DATA_SIZE);
-		if (out)
+		DCU_resolveThreadPolicy();
+	}
+
+	return DCU_thread_policy;
+}
+
+//
+// zero sized requests and null releases are reported by full and sampled threads
+//
+inline bool DCU_threadChecksProblems()
+{
+	DCU_TrackingPolicy policy = DCU_getThreadPolicy();
+	return !DCU_suppress_depth && ((policy == DCU_FullTracking) || (policy == DCU_SampledTracking));
+}
+
+void DCU_resolveThreadPolicy()
+{
+	//
+	// resolved first, requests made while matching use the default policy
+	//
+	DCU_thread_policy_generation = __atomic_load_n(&DCU_thread_names_generation, __ATOMIC_RELAXED);
+	DCU_thread_policy = DCU_default_policy;
+
+	if (DCU_thread_policy_rules_count)
+	{
+		char name[17];
+		memset(name, 0, sizeof(name));
+		prctl(PR_GET_NAME, name, 0, 0, 0);
+
+		for (unsigned int i = 0; i != DCU_thread_policy_rules_count; ++i)
 		{
-			memset(out, 0, size);
+			if (!fnmatch(DCU_thread_policy_rules[i].pattern, name, 0))
+			{
+				DCU_changeThreadPolicy(DCU_thread_policy_rules[i].policy);
+				break;
+			}
 		}
 	}
-	else if (type == DCU_ReallocType)
+}
+
+void DCU_applyThreadPolicy(DCU_TrackingPolicy const policy)
+{
+	if (unsigned(policy) < DCU_TRACKING_POLICIES)
 	{
-		bool old_allocation_found = false;
-		size_t old_size = 0;
+		DCU_thread_policy_set = true;
+		DCU_changeThreadPolicy(policy);
+	}
+}
 
-		if (DCU_STATE(DCU_TRACING))
+void DCU_changeThreadPolicy(DCU_TrackingPolicy const policy)
+{
+	if (unsigned(policy) >= DCU_TRACKING_POLICIES)
+	{
+		return;
+	}
+
+	//
+	// set before the thread requests an untracked block, its releases must see it
+	//
+	if (policy != DCU_FullTracking)
+	{
+		__atomic_store_n(&DCU_untracked_blocks, true, __ATOMIC_RELEASE);
+	}
+
+	DCU_thread_policy_generation = __atomic_load_n(&DCU_thread_names_generation, __ATOMIC_RELAXED);
+	DCU_thread_policy = policy;
+}
+
+void DCU_changeSuppression(int const change)
+{
+	if ((change > 0) && !DCU_suppress_depth)
+	{
+		__atomic_store_n(&DCU_untracked_blocks, true, __ATOMIC_RELEASE);
+	}
+
+	if ((change > 0) || DCU_suppress_depth)
+	{
+		DCU_suppress_depth += change;
+	}
+}
+
+inline bool DCU_admitRequest(size_t const size, bool& sampled)
+{
+	if (DCU_suppress_depth)
+	{
+		return false;
+	}
+
+	switch (DCU_getThreadPolicy())
+	{
+		case DCU_FullTracking:
+			return true;
+		case DCU_SampledTracking:
+			sampled = true;
+			return DCU_sampleRequest(size);
+		default:
+			return false;
+	}
+}
+
+//
+// counters threads count their requests instead of tracking them, suppressed requests aren't counted
+//
+inline bool DCU_threadCountsRequests()
+{
+	return DCU_THREAD_TRACING && !DCU_suppress_depth && (DCU_getThreadPolicy() == DCU_CountersTracking);
+}
+
+inline DCU_CountedTrailer* DCU_getCountedTrailer(DCU_ConstPointer const memory_address)
+{
+	return (DCU_CountedTrailer*) ((char const*) memory_address + DCU_blockUsableSize(memory_address) - sizeof(DCU_CountedTrailer));
+}
+
+void DCU_markCounted(DCU_ConstPointer const memory_address, size_t const size)
+{
+	DCU_CountedTrailer* trailer = DCU_getCountedTrailer(memory_address);
+	trailer->size = size;
+	trailer->magic = DCU_COUNTED_MAGIC(memory_address);
+}
+
+//
+// the release is counted whatever the policy of the releasing thread, with the size of the request
+//
+bool DCU_countRelease(DCU_DynamicOperationType const& type, DCU_ConstPointer const memory_address, size_t& size)
+{
+	DCU_CountedTrailer* trailer = DCU_getCountedTrailer(memory_address);
+	if (trailer->magic != DCU_COUNTED_MAGIC(memory_address))
+	{
+		return false;
+	}
+
+	trailer->magic = 0;
+	size = trailer->size;
+	DCU_countOperation(type, size);
+	return true;
+}
+
+void DCU_countOperation(DCU_DynamicOperationType const& type, size_t const size)
+{
+	DCU_MemoryStats& stats = DCU_counted_stats[type];
+#ifdef DCU_THREAD_SAFE
+	__sync_fetch_and_add(&stats.count, DCU_WEIGHT_ONE);
+	__sync_fetch_and_add(&stats.total_memory, size);
+
+	DCU_MemoryInt max_value = stats.max_value;
+	while ((size > max_value) && !__sync_bool_compare_and_swap(&stats.max_value, max_value, size))
+	{
+		max_value = stats.max_value;
+	}
+#else
+	stats.count += DCU_WEIGHT_ONE;
+	stats.total_memory += size;
+
+	if (size > stats.max_value)
+	{
+		stats.max_value = size;
+	}
+#endif //DCU_THREAD_SAFE
+}
+
+inline bool DCU_sampleRequest(size_t const size)
+{
+	DCU_sample_countdown -= ssize_t(size);
+	if (DCU_sample_countdown > 0)
+	{
+		return false;
+	}
+
+	return DCU_drawSample(size);
+}
+
+bool DCU_drawSample(size_t const size)
+{
+	//
+	// xorshift64*, 53 bits make a uniform value on (0, 1]
+	//
+	bool sampled = true;
+	if (!DCU_sample_random)
+	{
+		//
+		// first request of the thread, it is counted against the thread's first distance
+		//
+		DCU_sample_random = (DCU_HASH_FUNCTION(&DCU_sample_random) ^ (unsigned long long)(pthread_self())) | 1;
+		sampled = false;
+	}
+
+	do
+	{
+		DCU_sample_random ^= DCU_sample_random >> 12;
+		DCU_sample_random ^= DCU_sample_random << 25;
+		DCU_sample_random ^= DCU_sample_random >> 27;
+		double uniform = double(((DCU_sample_random * 0x2545F4914F6CDD1DULL) >> 11) + 1) * (1.0 / 9007199254740992.0);
+
+		DCU_sample_countdown = ssize_t(-log(uniform) * double(DCU_sample_interval));
+		if (!sampled)
 		{
-			DCU_MutexScopedLock lock(DCU_mutex);
-			DCU_OperationInfo* operation = DCU_findMemory(pointer);
-			if (operation)
-			{
-				old_allocation_found = true;
-				old_size = operation->size;
-				DCU_removeMemory(operation);
+			DCU_sample_countdown -= ssize_t(size);
+			sampled = (DCU_sample_countdown <= 0);
+		}
+	}
+	while (DCU_sample_countdown <= 0);
 
-				DCU_memory_stats[DCU_FreeType].count++;
-				DCU_memory_stats[DCU_FreeType].total_memory += operation->size;
-			}
+	return sampled;
+}
+
+void DCU_selectSiteProfile()
+{
+	DCU_site_profile_path = getenv(DCU_SITE_PROFILE_VARIABLE);
+	if (!DCU_site_profile_path || !*DCU_site_profile_path)
+	{
+		return;
+	}
+
+	FILE* profile = fopen(DCU_site_profile_path, "r");
+	if (!profile)
+	{
+		DCU_site_profile_mode = DCU_SiteProfileRecord;
+		return;
+	}
+
+	DCU_site_profile_mode = DCU_SiteProfileReplay;
+
+	//
+	// "0x<offset> <module>", the main program has an empty module name
+	//
+	char line[DCU_SITE_PROFILE_LINE_SIZE];
+	while (fgets(line, sizeof(line), profile))
+	{
+		line[strcspn(line, "\n")] = 0;
+
+		unsigned long offset = 0;
+		int name = 0;
+		if (sscanf(line, "%lx %n", &offset, &name) != 1)
+		{
+			continue;
 		}
 
-		out = DCU_malloc(size + OVERWRITE_DETECTION_DATA_SIZE);
-		if (out)
+		DCU_SiteModule module;
+		module.address = 0;
+		module.name = line + name;
+		module.base = 0;
+		module.found = false;
+		dl_iterate_phdr(DCU_matchSiteModule, &module);
+
+		if (module.found && !DCU_addProfiledCaller((DCU_ConstPointer) (module.base + offset)))
 		{
-#ifdef ALLOCATION_VALUE
-			memset(out, ALLOCATION_VALUE, size + OVERWRITE_DETECTION_DATA_SIZE);
-#endif
-			if (old_allocation_found)
+			fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp %s has more than %d sites\n", DCU_site_profile_path,
+					DCU_SITE_PROFILE_CAPACITY / 2);
+			break;
+		}
+	}
+
+	fclose(profile);
+}
+
+void DCU_writeSiteProfile()
+{
+	FILE* profile = fopen(DCU_site_profile_path, "w");
+	if (!profile)
+	{
+		fprintf(DCU_FALLBACK_STREAM, "DynamicCheckUp: Unable to write %s: %m\n", DCU_site_profile_path);
+		return;
+	}
+
+	for (DCU_ProblemInfo* iterator = DCU_problems.list; iterator; iterator = iterator->next)
+	{
+		DCU_StackId const stacks[2] = { iterator->allocation_stack, iterator->deallocation_stack };
+		for (unsigned int i = 0; i != 2; ++i)
+		{
+			DCU_StackEntry const& stack = DCU_getStack(stacks[i]);
+			if (!stack.depth || !DCU_addProfiledCaller(stack.frames[0]))
+			{
+				continue;
+			}
+
+			DCU_SiteModule module;
+			module.address = DCU_MemoryInt(stack.frames[0]);
+			module.name = 0;
+			module.base = 0;
+			module.found = false;
+			dl_iterate_phdr(DCU_matchSiteModule, &module);
+
+			if (module.found)
 			{
-				memcpy(out, pointer, ((size > old_size) ? old_size : size));
+				fprintf(profile, "0x%lx %s\n", module.address - module.base, module.name);
 			}
 		}
+	}
+
+	fclose(profile);
+}
+
+//
+// false when the caller is already there or the profile is full
+//
+bool DCU_addProfiledCaller(DCU_ConstPointer const caller)
+{
+	if ((DCU_site_profile_count * 2) == DCU_SITE_PROFILE_CAPACITY)
+	{
+		return false;
+	}
+
+	HastIterator slot = DCU_HASH_FUNCTION(caller) & (DCU_SITE_PROFILE_CAPACITY - 1);
+	for (; DCU_site_profile[slot]; slot = (slot + 1) & (DCU_SITE_PROFILE_CAPACITY - 1))
+	{
+		if (DCU_site_profile[slot] == caller)
+		{
+			return false;
+		}
+	}
+
+	DCU_site_profile[slot] = caller;
+	DCU_site_profile_count += 1;
+	return true;
+}
 
-		if (old_allocation_found)
+inline bool DCU_isProfiledCaller(DCU_ConstPointer const caller)
+{
+	HastIterator slot = DCU_HASH_FUNCTION(caller) & (DCU_SITE_PROFILE_CAPACITY - 1);
+	for (; DCU_site_profile[slot]; slot = (slot + 1) & (DCU_SITE_PROFILE_CAPACITY - 1))
+	{
+		if (DCU_site_profile[slot] == caller)
 		{
-			DCU_free(pointer);
+			return true;
 		}
 	}
+
+	return false;
+}
+
+int DCU_matchSiteModule(struct dl_phdr_info* info, size_t, void* data)
+{
+	DCU_SiteModule& module = *(DCU_SiteModule*) data;
+	if (module.name)
+	{
+		module.found = !strcmp(info->dlpi_name, module.name);
+	}
 	else
 	{
-		out = DCU_malloc(size + OVERWRITE_DETECTION_DATA_SIZE);
-#ifdef ALLOCATION_VALUE
-	memset(out, ALLOCATION_VALUE, size + OVERWRITE_DETECTION_DATA_SIZE);
-#endif
+		for (unsigned int i = 0; (i != info->dlpi_phnum) && !module.found; ++i)
+		{
+			ElfW(Phdr) const& header = info->dlpi_phdr[i];
+			DCU_MemoryInt segment = info->dlpi_addr + header.p_vaddr;
+			module.found = (header.p_type == PT_LOAD) && (module.address >= segment) &&
+					(module.address < (segment + header.p_memsz));
+		}
+		module.name = module.found ? info->dlpi_name : 0;
+	}
+
+	if (module.found)
+	{
+		module.base = info->dlpi_addr;
+	}
+
+	return module.found;
+}
+
+inline DCU_MemoryInt DCU_operationWeight(DCU_OperationInfo const* operation)
+{
+	if (!operation->sampled)
+	{
+		return DCU_WEIGHT_ONE;
+	}
+
+	double probability = -expm1(-double(operation->size) / double(DCU_sample_interval));
+	return DCU_MemoryInt(double(DCU_WEIGHT_ONE) / probability + 0.5);
+}
+
+#ifndef DCU_PASSTHROUGH
+//
+// with headers the padding is read from the header, so the header and then the chunk fields
+// in front of it must be readable first
+//
+bool DCU_isUntrackedChunk(DCU_ConstPointer const memory_address)
+{
+#ifdef DCU_INLINE_HEADERS
+	DCU_MemoryInt const address = DCU_MemoryInt(memory_address);
+	if ((address & (MALLOC_ALIGNMENT - 1)) || !DCU_readableBefore(address, sizeof(DCU_InlineHeader)))
+	{
+		return false;
+	}
+
+	size_t const offset = DCU_BLOCK_HEADER_SIZE + DCU_headerPadding(DCU_getInlineHeader(memory_address));
+	if (!DCU_readableBefore(address, offset + TWO_SIZE_T_SIZES))
+	{
+		return false;
+	}
+#endif //DCU_INLINE_HEADERS
+
+	mchunkptr const chunk = DCU_blockChunk(memory_address);
+	return ((chunk->head & (CINUSE_BIT | FLAG4_BIT)) == CINUSE_BIT) && DCU_ownsChunk(chunk);
+}
+
+//
+// the flag bits of a chunk are trusted only once an mspace is known to hold it,
+// an interior or foreign pointer lands on user data
+//
+bool DCU_ownsChunk(mchunkptr const chunk)
+{
+	if (!is_aligned(chunk2mem(chunk)))
+	{
+		return false;
+	}
+
+	//
+	// direct mappings belong to no segment, their offset, length and fencepost must match mmap_alloc,
+	// memalign adds the lead it skipped to the offset
+	//
+	if (is_mmapped(chunk))
+	{
+		size_t const offset = chunk->prev_foot & ~IS_MMAPPED_BIT;
+		size_t const size = chunksize(chunk);
+		return (offset <= (size_t) chunk)
+				&& ((((size_t) chunk - offset) & (mparams.page_size - 1)) == 0)
+				&& (((offset + size + MMAP_FOOT_PAD) & (mparams.page_size - 1)) == 0)
+#ifdef DCU_INLINE_HEADERS
+				&& (((size_t) chunk + size + SIZE_T_SIZE) <= __atomic_load_n(&DCU_space_high, __ATOMIC_ACQUIRE))
+#endif //DCU_INLINE_HEADERS
+				&& (chunk_plus_offset(chunk, size)->head == FENCEPOST_HEAD);
+	}
+
+#ifdef DCU_THREAD_MSPACES
+	//
+	// most blocks are released by the thread that requested them
+	//
+	if (DCU_thread_space && DCU_spaceHoldsChunk(DCU_thread_space, chunk))
+	{
+		return true;
+	}
+
+	if (DCU_spaceHoldsChunk(memory_space, chunk))
+	{
+		return true;
+	}
+
+	DCU_MutexScopedLock lock(DCU_thread_spaces_mutex);
+	for (unsigned int i = 0; i != DCU_thread_spaces_count; ++i)
+	{
+		if ((DCU_thread_spaces[i] != DCU_thread_space) && DCU_spaceHoldsChunk(DCU_thread_spaces[i], chunk))
+		{
+			return true;
+		}
+	}
+
+	return false;
+#else
+	return DCU_spaceHoldsChunk(memory_space, chunk);
+#endif //DCU_THREAD_MSPACES
+}
+
+//
+// segments are unmapped by trimming, the mspace lock keeps the list readable
+//
+bool DCU_spaceHoldsChunk(mspace const space, mchunkptr const chunk)
+{
+	mstate const state = (mstate) space;
+	bool holds = false;
+	if (!PREACTION(state))
+	{
+		msegmentptr const segment = segment_holding(state, (char*) chunk);
+		if (segment && (chunk != state->top)
+				&& (chunksize(chunk) < (size_t) (segment->base + segment->size - (char*) chunk)))
+		{
+			holds = (pinuse(next_chunk(chunk)) != 0);
+		}
+		POSTACTION(state);
+	}
+
+	return holds;
+}
+#endif //DCU_PASSTHROUGH
+
+//
+// not inlined, so the first frame is the caller's just like with backtrace
+//
+__attribute__((noinline)) bool DCU_walkFramePointers(DCU_ConstPointer* stack, unsigned int const size, unsigned int& depth)
+{
+	if (!DCU_resolveThreadStack())
+	{
+		return false;
+	}
+
+	//
+	// a frame holds the caller's frame pointer and the return address
+	//
+	DCU_ConstPointer const* frame = (DCU_ConstPointer const*) __builtin_frame_address(0);
+	DCU_MemoryInt low = DCU_thread_stack_low;
+	depth = 0;
+
+	for (; frame && (depth != size); ++depth)
+	{
+		DCU_MemoryInt address = DCU_MemoryInt(frame);
+		if ((address % sizeof(DCU_ConstPointer)) || (address < low) ||
+			((address + 2 * sizeof(DCU_ConstPointer)) > DCU_thread_stack_high) || !frame[1])
+		{
+			break;
+		}
+
+		stack[depth] = frame[1];
+		low = address + 2 * sizeof(DCU_ConstPointer);
+		frame = (DCU_ConstPointer const*) frame[0];
+	}
+
+	return (!frame && depth) || (depth >= DCU_FRAME_POINTER_MIN_FRAMES);
+}
+
+bool DCU_resolveThreadStack()
+{
+	if (DCU_thread_stack_state == DCU_StackRangeKnown)
+	{
+		return true;
 	}
 
-	if (out)
+	//
+	// pthread_getattr_np requests memory, stacks captured meanwhile come from backtrace
+	//
+	if (DCU_thread_stack_state != DCU_StackRangeUnknown)
 	{
+		return false;
+	}
 
-#ifdef OVERWRITE_DETECTION_DATA
-        memcpy((char*)(out) + size, OVERWRITE_DETECTION_DATA, OVERWRITE_DETECTION_DATA_SIZE);
-#endif
+	DCU_thread_stack_state = DCU_StackRangeResolving;
 
-		DCU_MutexScopedLock lock(DCU_mutex);
-		if (DCU_STATE(DCU_TRACING))
+	pthread_attr_t attributes;
+	if (pthread_getattr_np(pthread_self(), &attributes) == 0)
+	{
+		void* address = 0;
+		size_t size = 0;
+		if (pthread_attr_getstack(&attributes, &address, &size) == 0)
 		{
-			DCU_OperationInfo* operation = DCU_createOperation();
-			operation->memory_address = out;
-			operation->type = type;
-			operation->size = size;
-
-			DCU_createStackTrace(operation->stack);
-			DCU_addMemory(operation);
-
-			DCU_memory_stats[type].count++;
-			DCU_memory_stats[type].total_memory += size;
-
-			if (size > DCU_memory_stats[type].max_value)
-			{
-				DCU_memory_stats[type].max_value = size;
-			}
-
+			DCU_thread_stack_low = DCU_MemoryInt(address);
+			DCU_thread_stack_high = DCU_MemoryInt(address) + size;
+			DCU_thread_stack_state = DCU_StackRangeKnown;
 		}
+		pthread_attr_destroy(&attributes);
 	}
 
-//	DCU_write(" Done\n");
+	if (DCU_thread_stack_state != DCU_StackRangeKnown)
+	{
+		DCU_thread_stack_state = DCU_StackRangeUnavailable;
+	}
 
-	return out;
+	return DCU_thread_stack_state == DCU_StackRangeKnown;
 }
 
-void DCU_releaseMemory(DCU_DynamicOperationType const& type, void* pointer)
+//
+// the caller's registers are read from this function's frame, it always keeps a frame pointer
+//
+__attribute__((noinline)) bool DCU_walkCachedFrames(DCU_ConstPointer* stack, unsigned int const size, unsigned int& depth)
 {
-	DCU_initialize();
+#if defined(__x86_64__)
+	if (!DCU_resolveThreadStack())
+	{
+		return false;
+	}
 
-//	DCU_write("Release Type: %d Address:10%p", type, pointer);
+	DCU_MemoryInt const* frame = (DCU_MemoryInt const*) __builtin_frame_address(0);
+	DCU_MemoryInt frame_pointer = frame[0];
+	DCU_MemoryInt pc = frame[1];
+	DCU_MemoryInt stack_pointer = DCU_MemoryInt(frame + 2);
+	bool complete = false;
+	depth = 0;
 
-	if (pointer)
+	while (!complete)
 	{
+		stack[depth++] = (DCU_ConstPointer) pc;
+		if (depth == size)
 		{
-			DCU_MutexScopedLock lock(DCU_mutex);
-			if (DCU_STATE(DCU_TRACING))
-			{
-				DCU_OperationInfo* operation = DCU_findMemory(pointer);
-				if (operation)
-				{
-					DCU_memory_stats[type].count++;
-					DCU_memory_stats[type].total_memory += operation->size;
-
-#ifdef OVERWRITE_DETECTION_DATA
-					if (memcmp((char*)(pointer) + operation->size, OVERWRITE_DETECTION_DATA, OVERWRITE_DETECTION_DATA_SIZE))
-					{
-						DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE];
-						DCU_createStackTrace(stack);
-
-						DCU_ProblemInfo* problem = DCU_findProblem(&DCU_problems, DCU_MemoryOverWriteType, operation->stack, stack);
-						if (!problem)
-						{
-							problem = DCU_createProblem();
-							problem->type = DCU_MemoryOverWriteType;
-							memcpy(problem->allocation_stack, operation->stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-							memcpy(problem->deallocation_stack, stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-							DCU_addProblemToList(&DCU_problems, problem);
-						}
-						problem->count += 1;
-
-#ifdef DCU_ABORT_ON_MEMORY_OVERWRITE
-						DCU_abort("Abnormal program termination : 'Memory Overwrite Detected'\n");
-						return;
-#endif //DDCU_ABORT_ON_MEMORY_OVERWRITE
-					}
-#endif
+			complete = true;
+			break;
+		}
 
-#ifdef DEALLOCATION_VALUE
-					memset(pointer, DEALLOCATION_VALUE, operation->size + OVERWRITE_DETECTION_DATA_SIZE);
-#endif //DEALLOCATION_VALUE
+		//
+		// the return address may be the first byte of the next function
+		//
+		DCU_UnwindRule rule = DCU_findUnwindRule(pc - 1);
+		if (rule.status != DCU_UnwindRuleValid)
+		{
+			complete = (rule.status == DCU_UnwindRuleEnd);
+			break;
+		}
 
-					//
-					// Check for mismatch operations
-					//
-					bool mismatched_release = true;
-					if (type == DCU_FreeType)
-					{
-						mismatched_release = ! ((operation->type == DCU_MallocType) || (operation->type == DCU_CallocType) || (operation->type == DCU_ReallocType));
-					}
-					else if (type == DCU_DeleteType)
-					{
-						mismatched_release = (operation->type != DCU_NewType);
-					}
-					else if (type == DCU_DeleteArrayType)
-					{
-						mismatched_release = (operation->type != DCU_NewArrayType);
-					}
+		DCU_MemoryInt cfa = ((rule.cfa_register == DCU_UNWIND_RSP) ? stack_pointer : frame_pointer) + rule.cfa_offset;
+		DCU_MemoryInt return_address = cfa + rule.return_offset * DCU_UNWIND_WORD;
+		DCU_MemoryInt saved_frame = cfa + rule.frame_offset * DCU_UNWIND_WORD;
+		if ((cfa <= stack_pointer) || (cfa > DCU_thread_stack_high) ||
+			(return_address < stack_pointer) || ((return_address + DCU_UNWIND_WORD) > DCU_thread_stack_high) ||
+			(saved_frame < stack_pointer) || ((saved_frame + DCU_UNWIND_WORD) > DCU_thread_stack_high))
+		{
+			break;
+		}
 
-					if (mismatched_release)
-					{
-						DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE];
-						DCU_createStackTrace(stack);
-
-						DCU_ProblemInfo* problem = DCU_findProblem(&DCU_problems, DCU_MismatchOperationType, operation->stack, stack);
-						if (!problem)
-						{
-							problem = DCU_createProblem();
-							problem->type = DCU_MismatchOperationType;
-							memcpy(problem->allocation_stack, operation->stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-							memcpy(problem->deallocation_stack, stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-							DCU_addProblemToList(&DCU_problems, problem);
-						}
-						problem->count += 1;
-					}
+		pc = *(DCU_MemoryInt const*) return_address;
+		if (rule.frame_offset)
+		{
+			frame_pointer = *(DCU_MemoryInt const*) saved_frame;
+		}
+		stack_pointer = cfa;
 
-				}
-				else
-				{
-					//
-					// Releasing unallocated data
-					//
+		complete = !pc;
+	}
 
-					DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE];
-					DCU_createStackTrace(stack);
+	return complete || (depth >= DCU_FRAME_POINTER_MIN_FRAMES);
+#else
+	(void) stack;
+	(void) size;
+	depth = 0;
+	return false;
+#endif //__x86_64__
+}
 
-					DCU_ProblemInfo* problem = DCU_findProblem(&DCU_problems, DCU_ReleaseUnallocatedType, DCU_null_stack, stack);
-					if (!problem)
-					{
-						problem = DCU_createProblem();
-						problem->type = DCU_ReleaseUnallocatedType;
-						memcpy(problem->deallocation_stack, stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-						DCU_addProblemToList(&DCU_problems, problem);
-					}
-					problem->count += 1;
+#if defined(__x86_64__)
+inline DCU_UnwindRule DCU_findUnwindRule(DCU_MemoryInt const pc)
+{
+	DCU_UnwindCacheEntry& entry = DCU_unwind_cache[DCU_foldHash(HastIterator(pc) * HastIterator(0x9E3779B97F4A7C15ULL)) & (DCU_UNWIND_CACHE_SIZE - 1)];
+	if (entry.pc != pc)
+	{
+		entry.rule = DCU_compileUnwindRule(pc);
+		entry.pc = pc;
+	}
+	return entry.rule;
+}
 
-#ifdef DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
-					DCU_abort("Abnormal program termination : 'Release Unallocated Memory'\n");
-					return;
-#endif //DCU_ABORT_ON_RELEASE_NOT_REQUESTED_MEMORY
-				}
+DCU_UnwindRule DCU_compileUnwindRule(DCU_MemoryInt const pc)
+{
+	DCU_UnwindRule rule;
+	memset(&rule, 0, sizeof(rule));
+	rule.status = DCU_UnwindRuleUnsupported;
 
-				DCU_removeMemory(operation);
-			}
-		}
+	DCU_UnwindModule const* module = DCU_findUnwindModule(pc);
+	if (!module)
+	{
+		return rule;
+	}
 
-		DCU_free(pointer);
+	DCU_CommonInformation common;
+	DCU_MemoryInt location = 0;
+	unsigned char const* instructions = 0;
+	unsigned char const* instructions_end = 0;
+	if (!DCU_findFrameDescription(module->frame_header, pc, common, location, instructions, instructions_end))
+	{
+		return rule;
 	}
-	else // pointer is null
+
+	//
+	// the CIE program gives the initial rules, DCU_CFA_RESTORE goes back to them
+	//
+	DCU_CallFrameState initial;
+	initial.cfa_register = DCU_UNWIND_RSP;
+	initial.cfa_offset = 0;
+	initial.cfa_expression = false;
+	initial.frame_rule = DCU_RegisterSame;
+	initial.frame_offset = 0;
+	initial.return_rule = DCU_RegisterUndefined;
+	initial.return_offset = 0;
+
+	if (!DCU_runCallFrameProgram(common.instructions, common.instructions_end, common, location, location, initial, initial))
 	{
+		return rule;
+	}
 
-#ifdef DCU_C_MEMORY_CHECK
-		if (type == DCU_FreeType)
-		{
-			DCU_MutexScopedLock lock(DCU_mutex);
-			if (DCU_STATE(DCU_TRACING))
-			{
-				DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE];
-				DCU_createStackTrace(stack);
+	DCU_CallFrameState state = initial;
+	if (!DCU_runCallFrameProgram(instructions, instructions_end, common, location, pc, state, initial))
+	{
+		return rule;
+	}
 
-				DCU_ProblemInfo* problem = DCU_findProblem(&DCU_problems, DCU_FreeNullType, DCU_null_stack, stack);
-				if (!problem)
-				{
-					problem = DCU_createProblem();
-					problem->type = DCU_FreeNullType;
-					memcpy(problem->deallocation_stack, stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-					DCU_addProblemToList(&DCU_problems, problem);
-				}
+	if (state.return_rule == DCU_RegisterUndefined)
+	{
+		rule.status = DCU_UnwindRuleEnd;
+		return rule;
+	}
 
-				problem->count += 1;
-			}
-		}
-#endif //DCU_C_MEMORY_CHECK
+	if (state.cfa_expression ||
+		((state.cfa_register != DCU_UNWIND_RSP) && (state.cfa_register != DCU_UNWIND_RBP)) ||
+		(state.cfa_offset != DCU_SignedMemoryInt(int(state.cfa_offset))) ||
+		(state.return_rule != DCU_RegisterOffset) || (state.return_offset % DCU_UNWIND_WORD) ||
+		((state.frame_rule != DCU_RegisterSame) && (state.frame_rule != DCU_RegisterOffset)) ||
+		(state.frame_offset % DCU_UNWIND_WORD))
+	{
+		return rule;
+	}
 
+	DCU_SignedMemoryInt return_offset = state.return_offset / DCU_UNWIND_WORD;
+	DCU_SignedMemoryInt frame_offset = (state.frame_rule == DCU_RegisterOffset) ? (state.frame_offset / DCU_UNWIND_WORD) : 0;
+	if ((return_offset < -128) || (return_offset > 127) || (frame_offset < -128) || (frame_offset > 127))
+	{
+		return rule;
 	}
 
-//	DCU_write(" Done\n");
+	rule.cfa_offset = int(state.cfa_offset);
+	rule.cfa_register = (unsigned char) state.cfa_register;
+	rule.return_offset = (signed char) return_offset;
+	rule.frame_offset = (signed char) frame_offset;
+	rule.status = DCU_UnwindRuleValid;
+	return rule;
 }
 
-void DCU_analyzeMemory()
+DCU_UnwindModule const* DCU_findUnwindModule(DCU_MemoryInt const pc)
 {
-	//
-	// Memory Stats
-	//
-	for (unsigned int i = 0; i != DCU_DYNAMIC_OPERATION_TYPES; ++i)
+	for (unsigned int attempt = 0; attempt != 2; ++attempt)
 	{
-		switch (i)
+		unsigned int count = __atomic_load_n(&DCU_unwind_modules_count, __ATOMIC_ACQUIRE);
+		for (unsigned int i = 0; i != count; ++i)
 		{
-			case DCU_MallocType:
-			case DCU_ReallocType:
-			case DCU_CallocType:
-			{
-				DCU_memory_stats_c.count += DCU_memory_stats[i].count;
-				DCU_memory_stats_c.total_memory += DCU_memory_stats[i].total_memory;
-			}
-				break;
-			case DCU_FreeType:
-			{
-				DCU_memory_stats_c.count -= DCU_memory_stats[i].count;
-				DCU_memory_stats_c.total_memory -= DCU_memory_stats[i].total_memory;
-			}
-				break;
-			case DCU_NewType:
-			{
-				DCU_memory_stats_new.count += DCU_memory_stats[i].count;
-				DCU_memory_stats_new.total_memory += DCU_memory_stats[i].total_memory;
-			}
-				break;
-			case DCU_DeleteType:
-			{
-				DCU_memory_stats_new.count -= DCU_memory_stats[i].count;
-				DCU_memory_stats_new.total_memory -= DCU_memory_stats[i].total_memory;
-			}
-				break;
-			case DCU_NewArrayType:
+			DCU_UnwindModule const& module = DCU_unwind_modules[i];
+			if ((pc >= module.begin) && (pc < module.end) && __atomic_load_n(&module.loaded, __ATOMIC_RELAXED))
 			{
-				DCU_memory_stats_new_array.count += DCU_memory_stats[i].count;
-				DCU_memory_stats_new_array.total_memory += DCU_memory_stats[i].total_memory;
-			}
-				break;
-			case DCU_DeleteArrayType:
-			{
-				DCU_memory_stats_new_array.count -= DCU_memory_stats[i].count;
-				DCU_memory_stats_new_array.total_memory -= DCU_memory_stats[i].total_memory;
+				return &module;
 			}
-				break;
-			default:
-				break;
 		}
-	}
 
-	//
-	// Detect Memory Leaks
-	//
-	for (HastIterator hash_index = 0; hash_index != DCU_HASH_TABLE_SIZE; ++hash_index)
-	{
-		DCU_OperationInfo* iterator = DCU_memory[hash_index];
-		while(iterator)
+		//
+		// the address may belong to a module loaded after the last scan
+		//
+		if (!attempt)
 		{
-			DCU_ProblemInfo* problem = DCU_findProblem(&DCU_problems, DCU_LeakType, iterator->stack, DCU_null_stack);
-			if (!problem)
+			DCU_MutexScopedLock lock(DCU_unwind_modules_mutex);
+			for (unsigned int i = 0; i != DCU_unwind_modules_count; ++i)
 			{
-				problem = DCU_createProblem();
-				problem->type = DCU_LeakType;
-				memcpy(problem->allocation_stack, iterator->stack, DCU_STACK_TRACE_SIZE * sizeof(DCU_ConstPointer));
-				DCU_addProblemToList(&DCU_problems, problem);
+				__atomic_store_n(&DCU_unwind_modules[i].loaded, 0, __ATOMIC_RELAXED);
 			}
-			problem->count += 1;
-			problem->size = iterator->size;
-			problem->total_memory += iterator->size;
-
-			iterator = iterator->next;
+			dl_iterate_phdr(DCU_collectUnwindModule, 0);
 		}
 	}
 
+	return 0;
 }
 
-void DCU_reportMemoryStatus()
+int DCU_collectUnwindModule(struct dl_phdr_info* info, size_t, void*)
 {
-	DCU_write("DynamicCheckUp Memory Report\n");
-	DCU_write("----------------------------------------------------------------\n");
-	DCU_write("%15s %15s %15s %15s\n", "->", "operations", "total mem", "max value");
+	unsigned char const* frame_header = 0;
+	DCU_MemoryInt begin = ~DCU_MemoryInt(0);
+	DCU_MemoryInt end = 0;
 
-	for (unsigned int i = 0; i != DCU_DYNAMIC_OPERATION_TYPES; ++i)
+	for (unsigned int i = 0; i != info->dlpi_phnum; ++i)
 	{
-#ifndef DCU_C_MEMORY_CHECK
-		if (i < (unsigned int)(DCU_NewType))
+		ElfW(Phdr) const& header = info->dlpi_phdr[i];
+		if (header.p_type == PT_GNU_EH_FRAME)
 		{
-			continue;
+			frame_header = (unsigned char const*) (info->dlpi_addr + header.p_vaddr);
+		}
+		else if ((header.p_type == PT_LOAD) && (header.p_flags & PF_X))
+		{
+			DCU_MemoryInt segment = info->dlpi_addr + header.p_vaddr;
+			begin = (segment < begin) ? segment : begin;
+			end = ((segment + header.p_memsz) > end) ? (segment + header.p_memsz) : end;
 		}
-#endif //DCU_C_MEMORY_CHECK
-
-		DCU_write("%15s %15d %15d %15d\n",
-				DCU_OperationTypeNames[i],
-				DCU_memory_stats[i].count, DCU_memory_stats[i].total_memory, DCU_memory_stats[i].max_value);
 	}
 
-	DCU_write("\nDynamic Memory Balance\n");
-	DCU_write("----------------------------------------------------------------\n");
-#ifdef DCU_C_MEMORY_CHECK
-	DCU_write("%15s %15d %15d\n", "C Memory", DCU_memory_stats_c.count, DCU_memory_stats_c.total_memory);
-#endif //DCU_C_MEMORY_CHECK
-	DCU_write("%15s %15d %15d\n", "New Del", DCU_memory_stats_new.count, DCU_memory_stats_new.total_memory);
-	DCU_write("%15s %15d %15d\n", "New Del[]", DCU_memory_stats_new_array.count, DCU_memory_stats_new_array.total_memory);
-
-	DCU_write("\nProblems\n");
-	DCU_write("----------------------------------------------------------------\n");
-
-	DCU_ProblemInfo* iterator = DCU_problems;
-	while (iterator)
+	if (!frame_header || (begin >= end))
 	{
-		bool needs_allocation_stack = false;
-		bool needs_deallocation_stack = false;
-
-		DCU_write("{\n");
-		DCU_write("[%d] %s\n", iterator->type, DCU_ProblemTypenames[ iterator->type ]);
-		DCU_write("Count: %d\n", iterator->count);
+		return 0;
+	}
 
-		if (iterator->type == DCU_LeakType)
+	for (unsigned int i = 0; i != DCU_unwind_modules_count; ++i)
+	{
+		DCU_UnwindModule& module = DCU_unwind_modules[i];
+		if ((module.frame_header == frame_header) && (module.begin == begin) && (module.end == end))
 		{
-			DCU_write("Total Memory Lost: %d \n", iterator->total_memory);
-			needs_allocation_stack = true;
+			__atomic_store_n(&module.loaded, 1, __ATOMIC_RELAXED);
+			return 0;
 		}
+	}
 
-		if ((iterator->type == DCU_RequestZeroMemoryType) ||
-			(iterator->type == DCU_MismatchOperationType) ||
-			(iterator->type == DCU_MemoryOverWriteType))
-		{
-			needs_allocation_stack = true;
-		}
+	if (DCU_unwind_modules_count != DCU_UNWIND_MODULES)
+	{
+		DCU_UnwindModule& module = DCU_unwind_modules[DCU_unwind_modules_count];
+		module.begin = begin;
+		module.end = end;
+		module.frame_header = frame_header;
+		module.loaded = 1;
+		__atomic_store_n(&DCU_unwind_modules_count, DCU_unwind_modules_count + 1, __ATOMIC_RELEASE);
+	}
 
-		if ((iterator->type == DCU_FreeNullType) ||
-			(iterator->type == DCU_MismatchOperationType) ||
-			(iterator->type == DCU_ReleaseUnallocatedType) ||
-			(iterator->type == DCU_MemoryOverWriteType))
-		{
-			needs_deallocation_stack = true;
-		}
+	return 0;
+}
+
+bool DCU_findFrameDescription(unsigned char const* frame_header, DCU_MemoryInt const pc, DCU_CommonInformation& common,
+		DCU_MemoryInt& location, unsigned char const*& instructions, unsigned char const*& instructions_end)
+{
+	//
+	// only the usual binary search table of 32 bit offsets from .eh_frame_hdr is handled
+	//
+	if ((frame_header[0] != 1) || (frame_header[3] != (DCU_PE_DATAREL | DCU_PE_SDATA4)))
+	{
+		return false;
+	}
 
-		if (needs_allocation_stack)
+	bool valid = true;
+	unsigned char const* p = frame_header + 4;
+	DCU_readEncodedPointer(p, frame_header[1], DCU_MemoryInt(frame_header), valid);
+	DCU_MemoryInt count = DCU_readEncodedPointer(p, frame_header[2], DCU_MemoryInt(frame_header), valid);
+	if (!valid || !count)
+	{
+		return false;
+	}
+
+	int const* table = (int const*) p;
+	DCU_MemoryInt low = 0;
+	DCU_MemoryInt high = count;
+	while ((high - low) > 1)
+	{
+		DCU_MemoryInt middle = (low + high) / 2;
+		if ((DCU_MemoryInt(frame_header) + table[middle * 2]) <= pc)
 		{
-			DCU_write("Allocation Stack: ");
-			for (unsigned int frame = 0; frame != DCU_STACK_TRACE_SIZE; ++frame)
-			{
-				if (iterator->allocation_stack[frame])
-				{
-					DCU_write("%p ", iterator->allocation_stack[frame]);
-				}
-			}
-			DCU_write("\n");
+			low = middle;
 		}
-
-		if (needs_deallocation_stack)
+		else
 		{
-			DCU_write("Deallocation Stack: ");
-			for (unsigned int frame = 0; frame != DCU_STACK_TRACE_SIZE; ++frame)
-			{
-				if (iterator->deallocation_stack[frame])
-				{
-					DCU_write("%p ", iterator->deallocation_stack[frame]);
-				}
-			}
-			DCU_write("\n");
+			high = middle;
 		}
-
-		DCU_write("}\n");
-		iterator = iterator->next;
 	}
-}
-
 
-void DCU_abort(char const* message, ...)
-{
-	va_list argp;
-	va_start(argp, message);
-
-#ifdef DCU_ECHO
-if (DCU_stream != DCU_FALLBACK_STREAM)
-{
-	vfprintf(DCU_FALLBACK_STREAM, message, argp);
-}
-#endif //DDCU_ECHO
-
-	vfprintf(DCU_stream, message, argp);
-	va_end(argp);
+	if ((DCU_MemoryInt(frame_header) + table[low * 2]) > pc)
+	{
+		return false;
+	}
 
-	DCU_shutdown();
+	//
+	// FDE, its CIE and the range of addresses it covers
+	//
+	unsigned char const* description = frame_header + table[low * 2 + 1];
+	unsigned int length = 0;
+	unsigned int common_offset = 0;
+	memcpy(&length, description, sizeof(length));
+	memcpy(&common_offset, description + 4, sizeof(common_offset));
+	if (!length || (length == 0xFFFFFFFF) || !common_offset)
+	{
+		return false;
+	}
 
-	kill(getpid(), SIGKILL);
-	// just in case someone catches kill
-	_exit(-1);
-}
+	if (!DCU_parseCommonInformation(description + 4 - common_offset, common))
+	{
+		return false;
+	}
 
-void DCU_write(char const* message, ...)
-{
-	va_list argp;
-	va_start(argp, message);
+	p = description + 8;
+	location = DCU_readEncodedPointer(p, common.pointer_encoding, 0, valid);
+	DCU_MemoryInt range = DCU_readEncodedPointer(p, common.pointer_encoding & 0x0F, 0, valid);
+	if (!valid || (pc < location) || (pc >= (location + range)))
+	{
+		return false;
+	}
 
-#ifdef DCU_ECHO
-	if (DCU_stream != DCU_FALLBACK_STREAM)
+	if (common.augmentation_data)
 	{
-		vfprintf(DCU_FALLBACK_STREAM, message, argp);
+		DCU_MemoryInt augmentation_length = DCU_readUnsigned(p);
+		p += augmentation_length;
 	}
-#endif //DDCU_ECHO
 
-	vfprintf(DCU_stream, message, argp);
-	va_end(argp);
+	instructions = p;
+	instructions_end = description + 4 + length;
+	return true;
 }
 
-
-DCU_OperationInfo* DCU_createOperation()
+bool DCU_parseCommonInformation(unsigned char const* entry, DCU_CommonInformation& common)
 {
-	DCU_OperationInfo* element = (DCU_OperationInfo*) DCU_malloc( sizeof(DCU_OperationInfo) );
-	memset(element, 0,sizeof(DCU_OperationInfo) );
-	return element;
-}
+	unsigned int length = 0;
+	unsigned int identifier = 0;
+	memcpy(&length, entry, sizeof(length));
+	memcpy(&identifier, entry + 4, sizeof(identifier));
+	if (!length || (length == 0xFFFFFFFF) || identifier)
+	{
+		return false;
+	}
 
-DCU_ProblemInfo* DCU_createProblem()
-{
-	DCU_ProblemInfo* element = (DCU_ProblemInfo*) DCU_malloc( sizeof(DCU_ProblemInfo) );
-	memset(element, 0,sizeof(DCU_ProblemInfo) );
-	return element;
-}
+	unsigned char const* p = entry + 8;
+	unsigned char version = *p++;
+	char const* augmentation = (char const*) p;
+	p += strlen(augmentation) + 1;
+	if (strstr(augmentation, "eh"))
+	{
+		return false;
+	}
 
+	common.code_alignment = DCU_readUnsigned(p);
+	common.data_alignment = DCU_readSigned(p);
+	common.return_register = (version == 1) ? *p++ : DCU_readUnsigned(p);
+	common.pointer_encoding = DCU_PE_ABSPTR;
+	common.augmentation_data = (augmentation[0] == 'z');
 
-//
-// Operation management
-//
-void DCU_emptyOperationList(DCU_OperationInfo** list)
-{
-	DCU_OperationInfo* remove = 0;
-	while (*list)
+	if (common.augmentation_data)
 	{
-		remove = *list;
-		*list = (*list)->next;
-		DCU_free(remove);
+		DCU_MemoryInt augmentation_length = DCU_readUnsigned(p);
+		unsigned char const* augmentation_end = p + augmentation_length;
+		bool valid = true;
+
+		for (char const* letter = augmentation + 1; *letter && valid; ++letter)
+		{
+			if (*letter == 'R')
+			{
+				common.pointer_encoding = *p++;
+			}
+			else if (*letter == 'P')
+			{
+				unsigned char encoding = *p++;
+				DCU_readEncodedPointer(p, encoding & 0x7F, 0, valid);
+			}
+			else if (*letter == 'L')
+			{
+				p++;
+			}
+			else if (*letter != 'S')
+			{
+				break;
+			}
+		}
+
+		p = augmentation_end;
 	}
+
+	common.instructions = p;
+	common.instructions_end = entry + 4 + length;
+	return true;
 }
 
-void DCU_removeOperationFromList(DCU_OperationInfo** list, DCU_OperationInfo* element)
+bool DCU_runCallFrameProgram(unsigned char const* p, unsigned char const* end, DCU_CommonInformation const& common,
+		DCU_MemoryInt location, DCU_MemoryInt const pc, DCU_CallFrameState& state, DCU_CallFrameState const& initial)
 {
-	if (element)
+	DCU_CallFrameState remembered[DCU_UNWIND_STATE_DEPTH];
+	unsigned int remembered_count = 0;
+	bool valid = true;
+
+	while ((p < end) && valid)
 	{
-		DCU_OperationInfo* iterator = *list;
+		unsigned char operation = *p++;
+		DCU_MemoryInt advance = 0;
+		DCU_MemoryInt reg = 0;
+		DCU_SignedMemoryInt offset = 0;
 
-		if (iterator == element) // is the first element?
+		switch (operation & 0xC0)
 		{
-			*list = element->next;
-			DCU_free(element);
+			case DCU_CFA_ADVANCE_LOC:
+				advance = (operation & 0x3F) * common.code_alignment;
+				break;
+			case DCU_CFA_OFFSET:
+				DCU_setRegisterRule(state, common, operation & 0x3F, DCU_RegisterOffset, DCU_readUnsigned(p) * common.data_alignment);
+				continue;
+			case DCU_CFA_RESTORE:
+				DCU_restoreRegisterRule(state, initial, common, operation & 0x3F);
+				continue;
+			default:
+				break;
 		}
-		else
+
+		if (!advance)
 		{
-			while (iterator && (iterator->next != element))
+			switch (operation)
 			{
-				iterator = iterator->next;
+				case DCU_CFA_ADVANCE_LOC:
+				case DCU_CFA_NOP:
+				case DCU_CFA_GNU_ARGS_SIZE:
+					if (operation == DCU_CFA_GNU_ARGS_SIZE)
+					{
+						DCU_readUnsigned(p);
+					}
+					break;
+				case DCU_CFA_SET_LOC:
+				{
+					DCU_MemoryInt next = DCU_readEncodedPointer(p, common.pointer_encoding, 0, valid);
+					if (next > pc)
+					{
+						return valid;
+					}
+					location = next;
+				}
+					break;
+				case DCU_CFA_ADVANCE_LOC1:
+					advance = *p * common.code_alignment;
+					p += 1;
+					break;
+				case DCU_CFA_ADVANCE_LOC2:
+				{
+					unsigned short delta = 0;
+					memcpy(&delta, p, sizeof(delta));
+					advance = delta * common.code_alignment;
+					p += sizeof(delta);
+				}
+					break;
+				case DCU_CFA_ADVANCE_LOC4:
+				{
+					unsigned int delta = 0;
+					memcpy(&delta, p, sizeof(delta));
+					advance = delta * common.code_alignment;
+					p += sizeof(delta);
+				}
+					break;
+				case DCU_CFA_OFFSET_EXTENDED:
+					reg = DCU_readUnsigned(p);
+					DCU_setRegisterRule(state, common, reg, DCU_RegisterOffset, DCU_readUnsigned(p) * common.data_alignment);
+					break;
+				case DCU_CFA_OFFSET_EXTENDED_SF:
+					reg = DCU_readUnsigned(p);
+					DCU_setRegisterRule(state, common, reg, DCU_RegisterOffset, DCU_readSigned(p) * common.data_alignment);
+					break;
+				case DCU_CFA_GNU_NEGATIVE_OFFSET_EXTENDED:
+					reg = DCU_readUnsigned(p);
+					DCU_setRegisterRule(state, common, reg, DCU_RegisterOffset, -DCU_SignedMemoryInt(DCU_readUnsigned(p)) * common.data_alignment);
+					break;
+				case DCU_CFA_RESTORE_EXTENDED:
+					DCU_restoreRegisterRule(state, initial, common, DCU_readUnsigned(p));
+					break;
+				case DCU_CFA_UNDEFINED:
+					DCU_setRegisterRule(state, common, DCU_readUnsigned(p), DCU_RegisterUndefined, 0);
+					break;
+				case DCU_CFA_SAME_VALUE:
+					DCU_setRegisterRule(state, common, DCU_readUnsigned(p), DCU_RegisterSame, 0);
+					break;
+				case DCU_CFA_REGISTER:
+					reg = DCU_readUnsigned(p);
+					DCU_readUnsigned(p);
+					DCU_setRegisterRule(state, common, reg, DCU_RegisterUnsupported, 0);
+					break;
+				case DCU_CFA_REMEMBER_STATE:
+					if (remembered_count == DCU_UNWIND_STATE_DEPTH)
+					{
+						return false;
+					}
+					remembered[remembered_count++] = state;
+					break;
+				case DCU_CFA_RESTORE_STATE:
+					if (!remembered_count)
+					{
+						return false;
+					}
+					state = remembered[--remembered_count];
+					break;
+				case DCU_CFA_DEF_CFA:
+					state.cfa_register = (unsigned int) DCU_readUnsigned(p);
+					state.cfa_offset = DCU_SignedMemoryInt(DCU_readUnsigned(p));
+					state.cfa_expression = false;
+					break;
+				case DCU_CFA_DEF_CFA_SF:
+					state.cfa_register = (unsigned int) DCU_readUnsigned(p);
+					state.cfa_offset = DCU_readSigned(p) * common.data_alignment;
+					state.cfa_expression = false;
+					break;
+				case DCU_CFA_DEF_CFA_REGISTER:
+					state.cfa_register = (unsigned int) DCU_readUnsigned(p);
+					break;
+				case DCU_CFA_DEF_CFA_OFFSET:
+					state.cfa_offset = DCU_SignedMemoryInt(DCU_readUnsigned(p));
+					break;
+				case DCU_CFA_DEF_CFA_OFFSET_SF:
+					state.cfa_offset = DCU_readSigned(p) * common.data_alignment;
+					break;
+				case DCU_CFA_DEF_CFA_EXPRESSION:
+					offset = DCU_SignedMemoryInt(DCU_readUnsigned(p));
+					p += offset;
+					state.cfa_expression = true;
+					break;
+				case DCU_CFA_EXPRESSION:
+				case DCU_CFA_VAL_EXPRESSION:
+					reg = DCU_readUnsigned(p);
+					offset = DCU_SignedMemoryInt(DCU_readUnsigned(p));
+					p += offset;
+					DCU_setRegisterRule(state, common, reg, DCU_RegisterUnsupported, 0);
+					break;
+				case DCU_CFA_VAL_OFFSET:
+				case DCU_CFA_VAL_OFFSET_SF:
+					reg = DCU_readUnsigned(p);
+					if (operation == DCU_CFA_VAL_OFFSET)
+					{
+						DCU_readUnsigned(p);
+					}
+					else
+					{
+						DCU_readSigned(p);
+					}
+					DCU_setRegisterRule(state, common, reg, DCU_RegisterUnsupported, 0);
+					break;
+				default:
+					return false;
 			}
+		}
 
-			if (iterator)
+		if (advance)
+		{
+			if ((location + advance) > pc)
 			{
-				iterator->next = element->next;
-				DCU_free(element);
+				return valid;
 			}
+			location += advance;
 		}
 	}
+
+	return valid;
 }
 
-DCU_OperationInfo* DCU_findOperationOnList(DCU_OperationInfo* list, DCU_ConstPointer memory_address)
+inline void DCU_setRegisterRule(DCU_CallFrameState& state, DCU_CommonInformation const& common, DCU_MemoryInt const reg,
+		DCU_RegisterRule const rule, DCU_SignedMemoryInt const offset)
 {
-	DCU_OperationInfo* iterator = list;
-
-	while( iterator && (iterator->memory_address != memory_address) )
+	//
+	// only rbp and the return address are needed to reach the caller
+	//
+	if (reg == DCU_UNWIND_RBP)
 	{
-		iterator = iterator->next;
+		state.frame_rule = rule;
+		state.frame_offset = offset;
+	}
+	else if (reg == common.return_register)
+	{
+		state.return_rule = rule;
+		state.return_offset = offset;
 	}
-
-	return iterator;
 }
 
-void DCU_addOperationToList(DCU_OperationInfo** list, DCU_OperationInfo* element)
+inline void DCU_restoreRegisterRule(DCU_CallFrameState& state, DCU_CallFrameState const& initial, DCU_CommonInformation const& common,
+		DCU_MemoryInt const reg)
 {
-	element->next = *list;
-	*list = element;
+	if (reg == DCU_UNWIND_RBP)
+	{
+		state.frame_rule = initial.frame_rule;
+		state.frame_offset = initial.frame_offset;
+	}
+	else if (reg == common.return_register)
+	{
+		state.return_rule = initial.return_rule;
+		state.return_offset = initial.return_offset;
+	}
 }
 
-inline void DCU_addMemory(DCU_OperationInfo* element)
+DCU_MemoryInt DCU_readEncodedPointer(unsigned char const*& p, unsigned char const encoding, DCU_MemoryInt const data_base, bool& valid)
 {
-	if (element)
+	if (encoding == DCU_PE_OMIT)
 	{
-		ptrdiff_t hash_table_index = DCU_HASH_FUNCTION(element->memory_address);
-		DCU_addOperationToList(&DCU_memory[hash_table_index], element);
+		return 0;
 	}
-}
 
-inline DCU_OperationInfo* DCU_findMemory(DCU_ConstPointer memory_address)
-{
-	HastIterator hash_table_index = DCU_HASH_FUNCTION(memory_address);
-	return DCU_findOperationOnList(DCU_memory[hash_table_index], memory_address);
-}
+	DCU_MemoryInt const position = DCU_MemoryInt(p);
+	DCU_MemoryInt value = 0;
 
-inline void DCU_removeMemory(DCU_OperationInfo* element)
-{
-	if (element)
+	switch (encoding & 0x0F)
 	{
-		HastIterator hash_table_index = DCU_HASH_FUNCTION(element->memory_address);
-		DCU_removeOperationFromList(&DCU_memory[hash_table_index], element);
+		case DCU_PE_ABSPTR:
+		case DCU_PE_UDATA8:
+		case DCU_PE_SDATA8:
+			memcpy(&value, p, sizeof(value));
+			p += sizeof(value);
+			break;
+		case DCU_PE_ULEB128:
+			value = DCU_readUnsigned(p);
+			break;
+		case DCU_PE_SLEB128:
+			value = DCU_MemoryInt(DCU_readSigned(p));
+			break;
+		case DCU_PE_UDATA2:
+		{
+			unsigned short data = 0;
+			memcpy(&data, p, sizeof(data));
+			value = data;
+			p += sizeof(data);
+		}
+			break;
+		case DCU_PE_SDATA2:
+		{
+			short data = 0;
+			memcpy(&data, p, sizeof(data));
+			value = DCU_MemoryInt(DCU_SignedMemoryInt(data));
+			p += sizeof(data);
+		}
+			break;
+		case DCU_PE_UDATA4:
+		{
+			unsigned int data = 0;
+			memcpy(&data, p, sizeof(data));
+			value = data;
+			p += sizeof(data);
+		}
+			break;
+		case DCU_PE_SDATA4:
+		{
+			int data = 0;
+			memcpy(&data, p, sizeof(data));
+			value = DCU_MemoryInt(DCU_SignedMemoryInt(data));
+			p += sizeof(data);
+		}
+			break;
+		default:
+			valid = false;
+			return 0;
 	}
-}
 
-inline void DCU_emptyMemory()
-{
-	for (HastIterator i = 0; i != DCU_HASH_TABLE_SIZE; ++i)
+	switch (encoding & 0x70)
 	{
-		DCU_emptyOperationList(&DCU_memory[i]);
+		case DCU_PE_ABSPTR:
+			break;
+		case DCU_PE_PCREL:
+			value += position;
+			break;
+		case DCU_PE_DATAREL:
+			value += data_base;
+			break;
+		default:
+			valid = false;
+			return 0;
 	}
-}
-
-//
-// Generic DCU_ProblemInfo Linked-List Management
-//
 
-void DCU_emptyProblemList(DCU_ProblemInfo** list)
-{
-	DCU_ProblemInfo* remove = 0;
-	while (*list)
+	if (encoding & DCU_PE_INDIRECT)
 	{
-		remove = *list;
-		*list = (*list)->next;
-		DCU_free(remove);
+		value = *(DCU_MemoryInt const*) value;
 	}
+
+	return value;
 }
 
-void DCU_addProblemToList(DCU_ProblemInfo** list, DCU_ProblemInfo* element)
+DCU_MemoryInt DCU_readUnsigned(unsigned char const*& p)
 {
-	element->next = *list;
-	*list = element;
+	DCU_MemoryInt value = 0;
+	unsigned int shift = 0;
+	unsigned char byte = 0;
+	do
+	{
+		byte = *p++;
+		if (shift < (sizeof(DCU_MemoryInt) * 8))
+		{
+			value |= DCU_MemoryInt(byte & 0x7F) << shift;
+		}
+		shift += 7;
+	} while (byte & 0x80);
+	return value;
 }
 
-DCU_ProblemInfo* DCU_findProblem(DCU_ProblemInfo** list, DCU_ProblemType const type,
-		DCU_ConstPointer allocation_stack[DCU_STACK_TRACE_SIZE],
-		DCU_ConstPointer deallocation_stack[DCU_STACK_TRACE_SIZE])
+DCU_SignedMemoryInt DCU_readSigned(unsigned char const*& p)
 {
-	DCU_ProblemInfo* iterator = *list;
-	bool not_found = true;
-
-	while(not_found && iterator)
+	DCU_MemoryInt value = 0;
+	unsigned int shift = 0;
+	unsigned char byte = 0;
+	do
 	{
-		not_found = ( (iterator->type != type)
-					|| !DCU_stacksMatch(allocation_stack, iterator->allocation_stack)
-					|| !DCU_stacksMatch(deallocation_stack, iterator->deallocation_stack) );
-
-		if (not_found)
+		byte = *p++;
+		if (shift < (sizeof(DCU_MemoryInt) * 8))
 		{
-			iterator = iterator->next;
+			value |= DCU_MemoryInt(byte & 0x7F) << shift;
 		}
-	}
+		shift += 7;
+	} while (byte & 0x80);
 
-	return iterator;
+	if ((shift < (sizeof(DCU_MemoryInt) * 8)) && (byte & 0x40))
+	{
+		value |= ~DCU_MemoryInt(0) << shift;
+	}
+	return DCU_SignedMemoryInt(value);
 }
+#endif //__x86_64__
 
-inline void DCU_createStackTrace(DCU_ConstPointer stack[DCU_STACK_TRACE_SIZE])
+#ifdef __SSE2__
+inline bool DCU_stacksMatch(DCU_ConstPointer const* lhs, DCU_ConstPointer const* rhs, unsigned int const depth)
 {
-	memset(stack, 0, sizeof(stack));
-	backtrace((void**)(stack), DCU_STACK_TRACE_SIZE);
-}
+	//
+	// 16 bytes of frames per compare, all the byte masks must be set
+	//
+	unsigned int const frames_per_compare = sizeof(__m128i) / sizeof(DCU_ConstPointer);
+	unsigned int i = 0;
+	__m128i match = _mm_set1_epi8(-1);
+	for (; (i + frames_per_compare) <= depth; i += frames_per_compare)
+	{
+		__m128i left = _mm_loadu_si128((__m128i const*) (lhs + i));
+		__m128i right = _mm_loadu_si128((__m128i const*) (rhs + i));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(left, right));
+	}
+
+	bool tail = true;
+	for (; i != depth; ++i)
+	{
+		tail &= (lhs[i] == rhs[i]);
+	}
 
-bool DCU_stacksMatch(DCU_ConstPointer lhs[DCU_STACK_TRACE_SIZE], DCU_ConstPointer rhs[DCU_STACK_TRACE_SIZE])
+	return tail && (_mm_movemask_epi8(match) == 0xFFFF);
+}
+#else
+bool DCU_stacksMatch(DCU_ConstPointer const* lhs, DCU_ConstPointer const* rhs, unsigned int const depth)
 {
 	bool match = true;
 
-	for (unsigned int i = 0; i != DCU_STACK_TRACE_SIZE; ++i)
+	for (unsigned int i = 0; i != depth; ++i)
 	{
 		match &= (lhs[i] == rhs[i]);
 	}
 
 	return match;
 }
+#endif //__SSE2__
 
 //
 // Really sick thing :
@@ -1056,49 +6984,258 @@ bool DCU_stacksMatch(DCU_ConstPointer lhs[DCU_STACK_TRACE_SIZE], DCU_ConstPointe
 
 void* operator new(size_t size)
 {
-	return DCU_requestMemory(DCU_NewType, size, 0);
+	return DCU_requestNewMemory(DCU_NewType, size, __builtin_return_address(0), 0, 0);
 }
 
 void* operator new[](size_t size)
 {
-	return DCU_requestMemory(DCU_NewArrayType, size, 0);
+	return DCU_requestNewMemory(DCU_NewArrayType, size, __builtin_return_address(0), 0, 0);
+}
+
+void* operator new(size_t size, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	return DCU_requestNothrowMemory(DCU_NewType, size, __builtin_return_address(0), 0);
+}
+
+void* operator new[](size_t size, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	return DCU_requestNothrowMemory(DCU_NewArrayType, size, __builtin_return_address(0), 0);
+}
+
+void* DCU_requestSiteMemory(size_t size, DCU_Site const* site, bool const array)
+{
+	return DCU_requestNewMemory(array ? DCU_NewArrayType : DCU_NewType, size, __builtin_return_address(0), site, 0);
 }
 
 void operator delete (void *p)
 {
-	DCU_releaseMemory(DCU_DeleteType, p);
+	DCU_releaseMemory(DCU_DeleteType, p, __builtin_return_address(0), 0);
 }
 
 void operator delete[] (void *p)
 {
-	DCU_releaseMemory(DCU_DeleteArrayType, p);
+	DCU_releaseMemory(DCU_DeleteArrayType, p, __builtin_return_address(0), 0);
+}
+
+//
+// only called when a constructor throws after a nothrow new
+//
+void operator delete (void *p, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteType, p, __builtin_return_address(0), 0);
+}
+
+void operator delete[] (void *p, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteArrayType, p, __builtin_return_address(0), 0);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete (void *p, size_t size) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteType, p, __builtin_return_address(0), size);
+}
+
+void operator delete[] (void *p, size_t size) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteArrayType, p, __builtin_return_address(0), size);
 }
+#endif //__cpp_sized_deallocation
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return DCU_requestNewMemory(DCU_NewAlignedType, size, __builtin_return_address(0), 0, size_t(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return DCU_requestNewMemory(DCU_NewArrayAlignedType, size, __builtin_return_address(0), 0, size_t(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	return DCU_requestNothrowMemory(DCU_NewAlignedType, size, __builtin_return_address(0), size_t(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	return DCU_requestNothrowMemory(DCU_NewArrayAlignedType, size, __builtin_return_address(0), size_t(alignment));
+}
+
+void operator delete (void *p, std::align_val_t) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteAlignedType, p, __builtin_return_address(0), 0);
+}
+
+void operator delete[] (void *p, std::align_val_t) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteArrayAlignedType, p, __builtin_return_address(0), 0);
+}
+
+void operator delete (void *p, std::align_val_t, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteAlignedType, p, __builtin_return_address(0), 0);
+}
+
+void operator delete[] (void *p, std::align_val_t, std::nothrow_t const&) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteArrayAlignedType, p, __builtin_return_address(0), 0);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete (void *p, size_t size, std::align_val_t) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteAlignedType, p, __builtin_return_address(0), size);
+}
+
+void operator delete[] (void *p, size_t size, std::align_val_t) _GLIBCXX_USE_NOEXCEPT
+{
+	DCU_releaseMemory(DCU_DeleteArrayAlignedType, p, __builtin_return_address(0), size);
+}
+#endif //__cpp_sized_deallocation
+#endif //__cpp_aligned_new
 
 #ifdef DCU_C_MEMORY_CHECK
 
 void *malloc(size_t size)
 {
-	return DCU_requestMemory(DCU_MallocType, size, 0);
+	return DCU_requestMemory(DCU_MallocType, size, 0, __builtin_return_address(0), 0, 0);
 }
 
 void free(void* p)
 {
-	DCU_releaseMemory(DCU_FreeType, p);
+	DCU_releaseMemory(DCU_FreeType, p, __builtin_return_address(0), 0);
 }
 
 void* realloc(void *p, size_t size)
 {
-	return DCU_requestMemory(DCU_ReallocType, size, p);
+	return DCU_requestMemory(DCU_ReallocType, size, p, __builtin_return_address(0), 0, 0);
 }
 
 void* calloc(size_t nmemb, size_t size)
 {
-	return DCU_requestMemory(DCU_CallocType, size * nmemb, 0);
+	return DCU_requestMemory(DCU_CallocType, size * nmemb, 0, __builtin_return_address(0), 0, 0);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+	return DCU_requestAlignedMemory(alignment, size, __builtin_return_address(0));
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+	return DCU_requestAlignedMemory(alignment, size, __builtin_return_address(0));
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+	if (!alignment || (alignment % sizeof(void*)) || (alignment & (alignment - 1)))
+	{
+		return EINVAL;
+	}
+
+	void* out = DCU_requestAlignedMemory(alignment, size, __builtin_return_address(0));
+	if (!out && size)
+	{
+		return ENOMEM;
+	}
+
+	*memptr = out;
+	return 0;
+}
+
+void* valloc(size_t size)
+{
+	return DCU_requestAlignedMemory(sysconf(_SC_PAGESIZE), size, __builtin_return_address(0));
 }
 
-void* memalign(mspace msp, size_t alignment, size_t bytes)
+void* pvalloc(size_t size)
 {
-	return DCU_memalign(msp, alignment, bytes);
+	size_t const page_size = sysconf(_SC_PAGESIZE);
+	return DCU_requestAlignedMemory(page_size, (size + page_size - 1) & ~(page_size - 1), __builtin_return_address(0));
+}
+
+size_t malloc_usable_size(void* p)
+{
+	return DCU_usableMemory(p);
 }
 
 #endif //DCU_C_MEMORY_CHECK
+
+#ifdef DCU_MMAP_TRACKING
+
+void* mmap(void* address, size_t length, int protection, int flags, int fd, off_t offset)
+{
+	void* out = DCU_systemMmap(address, length, protection, flags, fd, offset);
+	if ((out != MAP_FAILED) && ((flags & MAP_ANONYMOUS) || (flags & MAP_FIXED)))
+	{
+		DCU_requestMapping(out, length, (flags & MAP_ANONYMOUS), __builtin_return_address(0));
+	}
+
+	return out;
+}
+
+void* mmap64(void* address, size_t length, int protection, int flags, int fd, off64_t offset)
+{
+	void* out = DCU_systemMmap(address, length, protection, flags, fd, offset);
+	if ((out != MAP_FAILED) && ((flags & MAP_ANONYMOUS) || (flags & MAP_FIXED)))
+	{
+		DCU_requestMapping(out, length, (flags & MAP_ANONYMOUS), __builtin_return_address(0));
+	}
+
+	return out;
+}
+
+int munmap(void* address, size_t length)
+{
+	int out = DCU_systemMunmap(address, length);
+	if (out == 0)
+	{
+		DCU_releaseMapping(address, length, __builtin_return_address(0));
+	}
+
+	return out;
+}
+
+void* mremap(void* old_address, size_t old_length, size_t new_length, int flags, ...)
+{
+	void* new_address = 0;
+	if (flags & MREMAP_FIXED)
+	{
+		va_list arguments;
+		va_start(arguments, flags);
+		new_address = va_arg(arguments, void*);
+		va_end(arguments);
+	}
+
+	void* out = DCU_systemMremap(old_address, old_length, new_length, flags, new_address);
+	if (out != MAP_FAILED)
+	{
+		DCU_moveMapping(old_address, old_length, out, new_length);
+	}
+
+	return out;
+}
+
+#endif //DCU_MMAP_TRACKING
+
+//
+// renamed threads match DCU_THREAD_POLICY again on their next request
+//
+int pthread_setname_np(pthread_t thread, const char* name)
+{
+	static int (*next_setname)(pthread_t, const char*);
+	if (!next_setname)
+	{
+		next_setname = (int (*)(pthread_t, const char*)) dlsym(RTLD_NEXT, "pthread_setname_np");
+	}
+
+	int out = next_setname ? next_setname(thread, name) : ENOSYS;
+	if (out == 0)
+	{
+		__sync_fetch_and_add(&DCU_thread_names_generation, 1);
+	}
+
+	return out;
+}
@@ -0,0 +1,129 @@
+/*
+ * DynamicCheckUp.h
+ *
+ *    Allocation sites known at compile time, requests made with DCU_NEW are recorded with a static
+ *    site descriptor instead of an unwound stack, and the report prints their file and line.
+ *
+ *    How To Use:
+ *    - include the header and tag the requests :
+ *    		MyClass* object = DCU_NEW MyClass(parameter);
+ *    		int* values = DCU_NEW int[count];
+ *    		DCU_DELETE object;
+ *    - DCU_NEW can only be used inside functions (the descriptor is a function static)
+ *    - over-aligned types are requested with the default alignment, use plain new for them
+ *    - without DynamicCheckUp the tagged requests fall back to the global operator new, either way
+ *      a failed request calls the new handler and throws std::bad_alloc
+ *    - latency critical threads can be tracked with a lighter policy :
+ *    		DCU_setThreadPolicy(DCU_CountersTracking);
+ *    - noisy regions (third party initialization) can be left out :
+ *    		{ DCU_SuppressGuard guard; initializeFonts(); }
+ *
+ */
+
+#ifndef DYNAMIC_CHECK_UP_H
+#define DYNAMIC_CHECK_UP_H
+
+#include <new>
+#include <cstddef>
+
+/* DCU_Site
+ * 		Allocation site descriptor, one constant instance per DCU_NEW expression.
+ */
+struct DCU_Site
+{
+	char const* file;
+	int line;
+	char const* function;
+};
+
+/* DCU_TrackingPolicy
+ * 		How the requests of a thread are tracked, see DCU_setThreadPolicy.
+ */
+enum DCU_TrackingPolicy
+{
+	DCU_FullTracking,
+	DCU_CountersTracking,
+	DCU_SampledTracking,
+	DCU_NoTracking
+};
+
+//
+// weak, so applications still link and run without DynamicCheckUp
+//
+void* DCU_requestSiteMemory(size_t size, DCU_Site const* site, bool const array) __attribute__((weak));
+void DCU_applyThreadPolicy(DCU_TrackingPolicy const policy) __attribute__((weak));
+void DCU_changeSuppression(int const change) __attribute__((weak));
+
+//
+// policy of the calling thread, blocks requested under a policy are released correctly under any other
+//
+inline void DCU_setThreadPolicy(DCU_TrackingPolicy const policy)
+{
+	if (DCU_applyThreadPolicy)
+	{
+		DCU_applyThreadPolicy(policy);
+	}
+}
+
+//
+// requests of the calling thread aren't tracked until the matching DCU_suppressEnd, their blocks are
+// still released correctly, regions can be nested
+//
+inline void DCU_suppressBegin()
+{
+	if (DCU_changeSuppression)
+	{
+		DCU_changeSuppression(1);
+	}
+}
+
+inline void DCU_suppressEnd()
+{
+	if (DCU_changeSuppression)
+	{
+		DCU_changeSuppression(-1);
+	}
+}
+
+/* DCU_SuppressGuard
+ * 		Suppresses tracking for the lifetime of the guard.
+ */
+class DCU_SuppressGuard
+{
+public:
+	DCU_SuppressGuard() { DCU_suppressBegin(); }
+	~DCU_SuppressGuard() { DCU_suppressEnd(); }
+
+private:
+	DCU_SuppressGuard(DCU_SuppressGuard const&);
+	DCU_SuppressGuard& operator=(DCU_SuppressGuard const&);
+};
+
+inline void* operator new(size_t size, DCU_Site const* site)
+{
+	return DCU_requestSiteMemory ? DCU_requestSiteMemory(size, site, false) : ::operator new(size);
+}
+
+inline void* operator new[](size_t size, DCU_Site const* site)
+{
+	return DCU_requestSiteMemory ? DCU_requestSiteMemory(size, site, true) : ::operator new[](size);
+}
+
+//
+// only called when a constructor throws
+//
+inline void operator delete(void* p, DCU_Site const*)
+{
+	::operator delete(p);
+}
+
+inline void operator delete[](void* p, DCU_Site const*)
+{
+	::operator delete[](p);
+}
+
+#define DCU_SITE ({ static DCU_Site const DCU_site = { __FILE__, __LINE__, __PRETTY_FUNCTION__ }; &DCU_site; })
+#define DCU_NEW new (DCU_SITE)
+#define DCU_DELETE delete
+
+#endif //DYNAMIC_CHECK_UP_H
@@ -0,0 +1,211 @@
+/*
+ * DynamicCheckUpBenchmark.cpp
+ *
+ *    Workloads behind the timings quoted in the revision notes, run with and without
+ *    DynamicCheckUp preloaded (see the benchmark Makefile target) :
+ *    - stress [threads]	every thread requests 200000 small blocks and releases them, a third
+ *    						after the loop, the first thread leaks one block
+ *    - blocks [count]		count live blocks, half released and requested again at random,
+ *    						every thousandth block leaked
+ *    - leaks [sites]		200000 leaked blocks requested from sites distinct stacks
+ *    - weights [size]		200000 blocks of size bytes, to compare the sampled estimate of the
+ *    						report with the exact count
+ *
+ */
+
+#include <pthread.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <time.h>
+
+using namespace std;
+
+unsigned int const STRESS_REQUESTS = 200000;
+unsigned int const LEAKED_BLOCKS = 200000;
+unsigned int const WEIGHT_REQUESTS = 200000;
+
+//
+// keeps the leaked blocks reachable to the compiler only
+//
+int* volatile leaked_block;
+
+double now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+void* stressWorker(void* argument)
+{
+	unsigned long id = (unsigned long) argument;
+	vector<char*> kept;
+	for (unsigned int i = 0; i != STRESS_REQUESTS; ++i)
+	{
+		char* block = new char[(i % 97) + 1];
+		block[0] = 1;
+		if (i % 3 == 0)
+		{
+			kept.push_back(block);
+		}
+		else
+		{
+			delete[] (block);
+		}
+		delete (new int(i));
+	}
+	for (size_t i = 0; i != kept.size(); ++i)
+	{
+		delete[] (kept[i]);
+	}
+	if (id == 0)
+	{
+		leaked_block = new int[7];
+	}
+	return 0;
+}
+
+void stress(unsigned int threads)
+{
+	vector<pthread_t> workers(threads);
+	for (unsigned long i = 0; i != threads; ++i)
+	{
+		pthread_create(&workers[i], 0, stressWorker, (void*) i);
+	}
+	for (unsigned int i = 0; i != threads; ++i)
+	{
+		pthread_join(workers[i], 0);
+	}
+}
+
+void blocks(unsigned int count)
+{
+	vector<int*> live(count);
+	srand(1);
+	for (unsigned int i = 0; i != count; ++i)
+	{
+		live[i] = new int(i);
+	}
+	for (unsigned int i = 0; i < count; i += 2)
+	{
+		delete (live[i]);
+		live[i] = 0;
+	}
+	for (unsigned int i = 0; i != count / 2; ++i)
+	{
+		int*& block = live[(rand() % (count / 2)) * 2];
+		delete (block);
+		block = new int(i);
+	}
+	for (unsigned int i = 0; i != count; ++i)
+	{
+		if (live[i] && i % 1000 != 0)
+		{
+			delete (live[i]);
+		}
+	}
+}
+
+//
+// one frame per base 3 digit of the site, so every site leaks from its own stack
+//
+void leakFrame0(unsigned int site, unsigned int depth);
+void leakFrame1(unsigned int site, unsigned int depth);
+void leakFrame2(unsigned int site, unsigned int depth);
+
+inline void leakFrom(unsigned int site, unsigned int depth)
+{
+	if (depth == 0)
+	{
+		leaked_block = new int(site);
+		return;
+	}
+	switch (site % 3)
+	{
+	case 0:
+		leakFrame0(site / 3, depth - 1);
+		break;
+	case 1:
+		leakFrame1(site / 3, depth - 1);
+		break;
+	default:
+		leakFrame2(site / 3, depth - 1);
+		break;
+	}
+}
+
+__attribute__((noinline)) void leakFrame0(unsigned int site, unsigned int depth)
+{
+	leakFrom(site, depth);
+	__asm__ volatile("");
+}
+
+__attribute__((noinline)) void leakFrame1(unsigned int site, unsigned int depth)
+{
+	leakFrom(site, depth);
+	__asm__ volatile("");
+}
+
+__attribute__((noinline)) void leakFrame2(unsigned int site, unsigned int depth)
+{
+	leakFrom(site, depth);
+	__asm__ volatile("");
+}
+
+void leaks(unsigned int sites)
+{
+	for (unsigned int i = 0; i != LEAKED_BLOCKS; ++i)
+	{
+		leakFrom(i % sites, 8);
+	}
+}
+
+void weights(size_t size)
+{
+	for (unsigned int i = 0; i != WEIGHT_REQUESTS; ++i)
+	{
+		char* block = new char[size];
+		block[0] = 0;
+		delete[] (block);
+	}
+	printf("exact: %u requests, %lu bytes\n", WEIGHT_REQUESTS, (unsigned long) WEIGHT_REQUESTS * size);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s stress|blocks|leaks|weights [value]\n", argv[0]);
+		return 1;
+	}
+	char const* workload = argv[1];
+	unsigned long value = argc > 2 ? strtoul(argv[2], 0, 10) : 0;
+
+	double start = now();
+	if (strcmp(workload, "stress") == 0)
+	{
+		stress(value ? value : 8);
+	}
+	else if (strcmp(workload, "blocks") == 0)
+	{
+		blocks(value ? value : 2000000);
+	}
+	else if (strcmp(workload, "leaks") == 0)
+	{
+		leaks(value ? value : 5000);
+	}
+	else if (strcmp(workload, "weights") == 0)
+	{
+		weights(value ? value : 4096);
+	}
+	else
+	{
+		fprintf(stderr, "unknown workload %s\n", workload);
+		return 1;
+	}
+	printf("%s %lu: %.3fs\n", workload, value, now() - start);
+
+	return 0;
+}
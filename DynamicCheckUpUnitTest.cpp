@@ -1,5 +1,10 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "DynamicCheckUp.h"
 
 using namespace std;
 
@@ -83,6 +88,15 @@ void mismatchTest_1()
 	delete (int_pointer2);
 }
 
+void mismatchTest_2()
+{
+	bool *bool_pointer0 = new bool[1];
+	delete (bool_pointer0);
+
+	int *int_pointer1 = new int();
+	delete[] (int_pointer1);
+}
+
 void releaseTest()
 {
 	int* zero_pointer = 0;
@@ -121,6 +135,21 @@ void releaseUnallocatedData()
 
 }
 
+void releaseInteriorData()
+{
+	//
+	// every word looks like the head of an in-use chunk whose next chunk is free,
+	// a release that trusts the head would hand the middle of the array to the allocator
+	//
+	size_t* size_t_pointer = new size_t[16];
+	for (unsigned int i = 0; i != 16; ++i)
+	{
+		size_t_pointer[i] = 0x22;
+	}
+	delete[] (&size_t_pointer[8]);
+
+}
+
 void memoryOverwrite()
 {
 	unsigned int size = 4;
@@ -132,10 +161,216 @@ void memoryOverwrite()
 
 }
 
+void reallocTest()
+{
+	char *char_pointer = (char*) realloc(0, 8);
+	memset(char_pointer, 'R', 8);
+
+	char_pointer = (char*) realloc((void*) char_pointer, 4096);
+	char_pointer[4095] = 'R';
+
+	char_pointer = (char*) realloc((void*) char_pointer, 2);
+	char_pointer = (char*) realloc((void*) char_pointer, 1 << 20);
+	free(char_pointer);
+}
+
+void alignedTest()
+{
+	void *void_pointer0 = 0;
+	if (posix_memalign(&void_pointer0, 64, 100) == 0)
+	{
+		free(void_pointer0);
+	}
+
+	void *void_pointer1 = aligned_alloc(4096, 4096);
+	void *void_pointer2 = memalign(256, 24);
+	free(void_pointer1);
+	free(void_pointer2);
+}
+
+struct AlignedType
+{
+	alignas(128) char data[32];
+};
+
+void alignedNewTest()
+{
+	AlignedType *aligned0 = new AlignedType();
+	AlignedType *aligned1 = new AlignedType[3];
+	delete (aligned0);
+	delete[] (aligned1);
+}
+
+void manyBlocksTest()
+{
+	unsigned int const count = 100000;
+	int **int_pointers = new int*[count];
+	for (unsigned int i = 0; i != count; ++i)
+	{
+		int_pointers[i] = new int(i);
+	}
+	for (unsigned int i = 0; i != count; i += 2)
+	{
+		delete (int_pointers[i]);
+	}
+	for (unsigned int i = 1; i < count; i += 2)
+	{
+		delete (int_pointers[i]);
+	}
+	delete[] (int_pointers);
+}
+
+//
+// every worker releases the blocks of the previous one, so releases cross shards, rings and mspaces
+//
+unsigned int const WORKERS = 4;
+unsigned int const WORKER_BLOCKS = 20000;
+char **worker_blocks[WORKERS];
+pthread_barrier_t worker_barrier;
+
+void* workerTest(void* argument)
+{
+	unsigned long id = (unsigned long) argument;
+	worker_blocks[id] = new char*[WORKER_BLOCKS];
+	for (unsigned int i = 0; i != WORKER_BLOCKS; ++i)
+	{
+		worker_blocks[id][i] = new char[(i % 97) + 1];
+		delete (new int(i));
+	}
+	pthread_barrier_wait(&worker_barrier);
+
+	char **released = worker_blocks[(id + 1) % WORKERS];
+	for (unsigned int i = 0; i != WORKER_BLOCKS; ++i)
+	{
+		delete[] (released[i]);
+	}
+	pthread_barrier_wait(&worker_barrier);
+
+	delete[] (worker_blocks[id]);
+	return 0;
+}
+
+void threadTest()
+{
+	pthread_t threads[WORKERS];
+	pthread_barrier_init(&worker_barrier, 0, WORKERS);
+	for (unsigned long i = 0; i != WORKERS; ++i)
+	{
+		pthread_create(&threads[i], 0, workerTest, (void*) i);
+	}
+	for (unsigned int i = 0; i != WORKERS; ++i)
+	{
+		pthread_join(threads[i], 0);
+	}
+	pthread_barrier_destroy(&worker_barrier);
+}
+
+void siteTest()
+{
+	int *int_pointer0 = DCU_NEW int(3);
+	double *double0 = DCU_NEW double[16];
+	DCU_DELETE (int_pointer0);
+	DCU_DELETE[] (double0);
+}
+
+void policyTest()
+{
+	int *full_pointer = new int();
+
+	DCU_setThreadPolicy(DCU_CountersTracking);
+	int *counted_pointer = new int();
+	delete (full_pointer);
+
+	DCU_setThreadPolicy(DCU_SampledTracking);
+	int *sampled_pointer = new int[64];
+	delete (counted_pointer);
+
+	DCU_setThreadPolicy(DCU_NoTracking);
+	int *untracked_pointer = new int();
+	delete[] (sampled_pointer);
+
+	DCU_setThreadPolicy(DCU_FullTracking);
+	delete (untracked_pointer);
+}
+
+void suppressionTest()
+{
+	int *int_pointer0 = 0;
+	{
+		DCU_SuppressGuard guard;
+		int_pointer0 = new int();
+		delete[] (new int[8]);
+	}
+	delete (int_pointer0);
+}
+
+void mmapTest()
+{
+	size_t const page = 4096;
+	char *mapping = (char*) mmap(0, 4 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+	{
+		return;
+	}
+	mapping[0] = 'M';
+
+	mapping = (char*) mremap(mapping, 4 * page, 8 * page, MREMAP_MAYMOVE);
+	if (mapping == MAP_FAILED)
+	{
+		return;
+	}
+
+	munmap(mapping, 8 * page);
+}
+
+void threadLeakWorker()
+{
+	newAndLoseMemory(32);
+}
+
+void* threadLeakTest(void*)
+{
+	threadLeakWorker();
+	return 0;
+}
+
+void threadLeak()
+{
+	pthread_t thread;
+	pthread_create(&thread, 0, threadLeakTest, 0);
+	pthread_join(thread, 0);
+}
+
+void mappingLeak()
+{
+	mmap(0, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+}
+
+void partialUnmap()
+{
+	size_t const page = 4096;
+	char *mapping = (char*) mmap(0, 4 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping != MAP_FAILED)
+	{
+		munmap(mapping + page, page);
+		munmap(mapping, page);
+		munmap(mapping + 2 * page, 2 * page);
+	}
+}
+
 void runTests()
 {
 	newTest();
 	mallocTest();
+	reallocTest();
+	alignedTest();
+	alignedNewTest();
+	manyBlocksTest();
+	threadTest();
+	siteTest();
+	policyTest();
+	suppressionTest();
+	mmapTest();
 
 	//
 	// uncomment the following
@@ -147,7 +382,11 @@ void runTests()
 	//	mismatchTest_0();
 	//	mismatchTest_1();
 	//	releaseUnallocatedData();
+	//	releaseInteriorData();
 	//memoryOverwrite();
+	//	threadLeak();
+	//	mappingLeak();
+	//	partialUnmap();
 }
 
 void stackH()
@@ -187,8 +426,52 @@ void beginTests()
 	stackA();
 }
 
-int main()
+//
+// tests that leave a problem in the report, "make check" runs each one alone and looks for it
+//
+struct ProblemTest
+{
+	char const* name;
+	void (*run)();
+};
+
+ProblemTest const PROBLEM_TESTS[] =
+{
+	{ "mismatchTest_0", mismatchTest_0 },
+	{ "mismatchTest_1", mismatchTest_1 },
+	{ "mismatchTest_2", mismatchTest_2 },
+	{ "releaseTest", releaseTest },
+	{ "requestZeroMemory", requestZeroMemory },
+	{ "releaseUnallocatedData", releaseUnallocatedData },
+	{ "releaseInteriorData", releaseInteriorData },
+	{ "memoryOverwrite", memoryOverwrite },
+	{ "threadLeak", threadLeak },
+	{ "mappingLeak", mappingLeak },
+	{ "partialUnmap", partialUnmap },
+};
+
+int runProblemTest(char const* name)
+{
+	for (unsigned int i = 0; i != sizeof(PROBLEM_TESTS) / sizeof(PROBLEM_TESTS[0]); ++i)
+	{
+		if (strcmp(PROBLEM_TESTS[i].name, name) == 0)
+		{
+			PROBLEM_TESTS[i].run();
+			return 0;
+		}
+	}
+
+	cerr << "Unknown test " << name << endl;
+	return 1;
+}
+
+int main(int argc, char** argv)
 {
+	if (argc > 1)
+	{
+		return runProblemTest(argv[1]);
+	}
+
 	cout << "Application Start." << endl;
 	for (unsigned int i = 0; i != 1; ++i)
 	{